@@ -0,0 +1,40 @@
+/**
+ * @file cpu_features.hpp
+ * @brief Run-time x86 vector ISA detection shared by the SIMD kernels.
+ */
+
+#pragma once
+
+// x86 kernels are compiled per function with target attributes and picked
+// at run time, so the build itself needs no -m flags
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_FEATURES_X86 1
+#endif
+
+namespace cpu_features {
+
+/**
+ * @brief Vector instruction sets the kernels are compiled for.
+ */
+enum class Isa {
+    SCALAR,
+    AVX2,
+    AVX512
+};
+
+/**
+ * @brief Whether the running CPU can execute @p isa.
+ */
+inline bool supported(Isa isa) {
+#ifdef CPU_FEATURES_X86
+    switch (isa) {
+        case Isa::AVX2: return __builtin_cpu_supports("avx2");
+        case Isa::AVX512: return __builtin_cpu_supports("avx512f");
+        default: return true;
+    }
+#else
+    return isa == Isa::SCALAR;
+#endif
+}
+
+}  // namespace cpu_features
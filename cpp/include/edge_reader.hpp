@@ -0,0 +1,56 @@
+/**
+ * @file edge_reader.hpp
+ * @brief Edge metadata readers producing columnar records.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace edge_reader {
+
+/**
+ * @brief Edge metadata rows in file order, one array per column.
+ */
+struct EdgeRecords {
+    std::vector<uint32_t> id;
+    std::vector<uint64_t> incoming_cell;
+    std::vector<uint64_t> outgoing_cell;
+    std::vector<int32_t> lca_res;
+    std::vector<double> length;
+    std::vector<double> cost;
+
+    size_t size() const { return id.size(); }
+    void append(const EdgeRecords& other);
+};
+
+/**
+ * @brief Parse an edge metadata CSV.
+ *
+ * The file is memory-mapped and split at line boundaries into chunks that
+ * are parsed in parallel. Only the length, cost, incoming_cell,
+ * outgoing_cell, lca_res and id columns are converted; rows with fewer than
+ * 11 fields or an unparsable value are skipped.
+ *
+ * @return false if the file cannot be opened
+ */
+bool read_csv(const std::string& path, EdgeRecords& out);
+
+/**
+ * @brief Read edge metadata from a Parquet file or directory of files.
+ *
+ * Columns id, incoming_cell, outgoing_cell, lca_res, length and cost are
+ * selected by name and may use any integer or floating-point type; other
+ * columns are not decoded. Row groups are read in parallel and rows keep
+ * (file name, row group, row) order. Rows with a null in a selected column
+ * are skipped. Read errors and missing columns throw, as in
+ * ShortcutGraph::load_shortcuts.
+ *
+ * @return false if the directory holds no Parquet files
+ */
+bool read_parquet(const std::string& path, EdgeRecords& out);
+
+}  // namespace edge_reader
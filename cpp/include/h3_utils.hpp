@@ -1,6 +1,11 @@
 /**
  * @file h3_utils.hpp
  * @brief H3 utility functions for hierarchical routing.
+ *
+ * The hierarchy operations work directly on the bits of the index and are
+ * constexpr, so the query loops inline them. They expect valid H3 cells
+ * (or 0); the libh3 namespace has the same operations through the library
+ * for cross-checking.
  */
 
 #pragma once
@@ -9,25 +14,107 @@
 
 namespace h3_utils {
 
+// Cell index layout: mode and reserved bits, 4-bit resolution at bit 52,
+// 7-bit base cell at bit 45, then 15 3-bit digits from resolution 1 down;
+// digits below the cell's resolution are all ones (7)
+constexpr int MAX_RES = 15;
+constexpr int RES_OFFSET = 52;
+constexpr uint64_t RES_MASK = uint64_t(15) << RES_OFFSET;
+constexpr int BASE_CELL_OFFSET = 45;
+constexpr int DIGIT_BITS = 3;
+
 /**
- * @brief Get resolution of an H3 cell.
+ * @brief Bits of the digits finer than resolution @p res.
  */
-int get_resolution(uint64_t cell);
+constexpr uint64_t digits_below(int res) {
+    return (uint64_t(1) << ((MAX_RES - res) * DIGIT_BITS)) - 1;
+}
+
+/**
+ * @brief Get resolution of an H3 cell, -1 for 0.
+ */
+constexpr int get_resolution(uint64_t cell) {
+    return cell == 0 ? -1 : static_cast<int>((cell & RES_MASK) >> RES_OFFSET);
+}
 
 /**
  * @brief Get parent cell at target resolution.
+ *
+ * Sets the resolution field and fills the dropped digits with 7. Returns
+ * the cell itself if it is not finer than target_res, 0 for 0 or a
+ * negative target_res.
  */
-uint64_t cell_to_parent(uint64_t cell, int target_res);
+constexpr uint64_t cell_to_parent(uint64_t cell, int target_res) {
+    if (cell == 0 || target_res < 0) return 0;
+    if (target_res >= get_resolution(cell)) return cell;
+    return (cell & ~RES_MASK) | (uint64_t(target_res) << RES_OFFSET) | digits_below(target_res);
+}
 
 /**
  * @brief Find lowest common ancestor of two H3 cells.
+ *
+ * Both cells are truncated to the coarser resolution. The highest
+ * differing bit of the two then lies in the first differing digit, and
+ * the ancestor is one resolution above it. Cells under different base
+ * cells have none (0).
  */
-uint64_t find_lca(uint64_t cell1, uint64_t cell2);
+constexpr uint64_t find_lca(uint64_t cell1, uint64_t cell2) {
+    if (cell1 == 0 || cell2 == 0) return 0;
+
+    int res1 = get_resolution(cell1);
+    int res2 = get_resolution(cell2);
+    int min_res = (res1 < res2) ? res1 : res2;
+
+    uint64_t c1 = cell_to_parent(cell1, min_res);
+    uint64_t c2 = cell_to_parent(cell2, min_res);
+    uint64_t diff = c1 ^ c2;
+    if (diff == 0) return c1;
+    if (diff >> BASE_CELL_OFFSET) return 0;
+
+#if defined(__GNUC__) || defined(__clang__)
+    int high_bit = 63 - __builtin_clzll(diff);
+#else
+    int high_bit = 0;
+    while (diff >> (high_bit + 1)) ++high_bit;
+#endif
+    int first_differing = MAX_RES - high_bit / DIGIT_BITS;
+    return cell_to_parent(c1, first_differing - 1);
+}
 
 /**
  * @brief Check if node_cell is within high_cell region.
+ *
+ * Truncates without checking the node's resolution: a node coarser than
+ * high_res keeps a 7 digit above high_res, which no valid cell has, and a
+ * 0 node lacks the cell mode bit, so neither matches.
  * @return true if node is within the high_cell ancestor
  */
+constexpr bool parent_check(uint64_t node_cell, uint64_t high_cell, int high_res) {
+    if (high_cell == 0 || high_res < 0) return true;
+    return ((node_cell & ~RES_MASK) | (uint64_t(high_res) << RES_OFFSET) | digits_below(high_res)) == high_cell;
+}
+
+// Known libh3 results, checked at compile time
+static_assert(cell_to_parent(0x8928308280fffff, 8) == 0x8828308281fffff, "cell_to_parent");
+static_assert(cell_to_parent(0x8928308280fffff, 5) == 0x85283083fffffff, "cell_to_parent");
+static_assert(find_lca(0x8928308280fffff, 0x8828308281fffff) == 0x8828308281fffff, "find_lca");
+static_assert(parent_check(0x8928308280fffff, 0x85283083fffffff, 5), "parent_check");
+
+/**
+ * @brief The same operations through libh3, for cross-checking.
+ */
+namespace libh3 {
+
+int get_resolution(uint64_t cell);
+uint64_t cell_to_parent(uint64_t cell, int target_res);
+uint64_t find_lca(uint64_t cell1, uint64_t cell2);
 bool parent_check(uint64_t node_cell, uint64_t high_cell, int high_res);
 
+/**
+ * @brief Cell containing a point (degrees) at @p res, 0 on error.
+ */
+uint64_t lat_lng_to_cell(double lat, double lng, int res);
+
+}  // namespace libh3
+
 }  // namespace h3_utils
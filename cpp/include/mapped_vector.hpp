@@ -0,0 +1,86 @@
+/**
+ * @file mapped_vector.hpp
+ * @brief Read-only array that either owns its elements or views a mapped snapshot.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Contiguous array backed by a std::vector or by borrowed memory.
+ *
+ * Graph arrays built by the loaders own their storage; arrays opened from a
+ * snapshot point into the mapping and keep it alive through @p owner.
+ * Mutation goes through take(), which copies borrowed data first.
+ */
+template <typename T>
+class MappedVector {
+public:
+    MappedVector() = default;
+
+    MappedVector(std::vector<T> v) : owned_(std::move(v)) { point_at_owned(); }
+
+    MappedVector(std::shared_ptr<const void> owner, const T* data, size_t size)
+        : owner_(std::move(owner)), data_(data), size_(size) {}
+
+    MappedVector(const MappedVector& o) : owned_(o.owned_), owner_(o.owner_), data_(o.data_), size_(o.size_) {
+        if (!owner_) point_at_owned();
+    }
+
+    MappedVector(MappedVector&& o) noexcept
+        : owned_(std::move(o.owned_)), owner_(std::move(o.owner_)), data_(o.data_), size_(o.size_) {
+        if (!owner_) point_at_owned();
+        o.clear();
+    }
+
+    MappedVector& operator=(MappedVector o) noexcept {
+        owned_ = std::move(o.owned_);
+        owner_ = std::move(o.owner_);
+        data_ = o.data_;
+        size_ = o.size_;
+        if (!owner_) point_at_owned();
+        return *this;
+    }
+
+    /**
+     * @brief Move the elements out as a vector, copying if borrowed.
+     */
+    std::vector<T> take() {
+        std::vector<T> out = owner_ ? std::vector<T>(data_, data_ + size_) : std::move(owned_);
+        clear();
+        return out;
+    }
+
+    void clear() {
+        owned_.clear();
+        owner_.reset();
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    /**
+     * @brief True if the elements live in a mapped snapshot.
+     */
+    bool is_mapped() const { return owner_ != nullptr; }
+
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+private:
+    void point_at_owned() {
+        data_ = owned_.data();
+        size_ = owned_.size();
+    }
+
+    std::vector<T> owned_;
+    std::shared_ptr<const void> owner_;
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
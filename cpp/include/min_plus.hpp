@@ -0,0 +1,86 @@
+/**
+ * @file min_plus.hpp
+ * @brief Bucket joins for distance matrices: min-plus row updates with SIMD kernels.
+ */
+
+#pragma once
+
+#include "cpu_features.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace min_plus {
+
+/**
+ * @brief Row update kernel. AVX2 and AVX-512 are only used when the CPU has them.
+ */
+enum class Kernel {
+    SCALAR,
+    AVX2,
+    AVX512
+};
+
+/**
+ * @brief Whether the running CPU can execute @p kernel.
+ */
+bool supported(Kernel kernel);
+
+/**
+ * @brief Fastest kernel supported by the running CPU, detected once.
+ *
+ * AVX2 is preferred over AVX-512: the masked scatter measured slower than
+ * four scalar stores (docs/benchmarks.md). routing_bench --join times all.
+ */
+Kernel best_kernel();
+
+const char* kernel_name(Kernel kernel);
+
+/**
+ * @brief row[cols[k]] = min(row[cols[k]], d + vals[k]) for k in [0, n).
+ *
+ * Indices within one call must be distinct and below 2^31 (they are used
+ * as gather/scatter offsets).
+ */
+void relax(Kernel kernel, double* row, const uint32_t* cols, const double* vals, size_t n, double d);
+
+/**
+ * @brief (column, distance) buckets per node, structure-of-arrays.
+ *
+ * Bucket u is [offsets[u], offsets[u + 1]) of cols and dists, with
+ * columns in ascending order.
+ */
+struct Buckets {
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> cols;
+    std::vector<double> dists;
+};
+
+/**
+ * @brief Bucket the settled (node, distance) lists of each column.
+ *
+ * Releases the per-column lists while filling.
+ */
+Buckets build_buckets(size_t node_count, std::vector<std::vector<std::pair<uint32_t, double>>>& settled);
+
+/**
+ * @brief Columns per tile of a row join; 512 KB of row stays in L2.
+ *
+ * Smaller, L1-sized tiles measured slower: the per-tile bucket splitting
+ * costs more than the misses it saves while the row still fits in L2.
+ */
+constexpr uint32_t TILE_COLUMNS = 1 << 16;
+
+/**
+ * @brief Fold one row's settled (node, distance) list into row.
+ *
+ * row[j] = min over settled (u, d) and bucket entries (j, db) of u of
+ * d + db. Rows wider than TILE_COLUMNS are processed one column tile at a
+ * time, so the tile of row being updated stays in cache.
+ */
+void join_row(const Buckets& buckets, const std::vector<std::pair<uint32_t, double>>& settled,
+              double* row, size_t num_cols, Kernel kernel);
+
+}  // namespace min_plus
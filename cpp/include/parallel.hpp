@@ -0,0 +1,70 @@
+/**
+ * @file parallel.hpp
+ * @brief Minimal fork-join helpers over std::thread.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+/**
+ * @brief Number of hardware threads, at least 1.
+ */
+inline unsigned default_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+/**
+ * @brief Run f(i) for every i in [0, n) on up to @p threads workers.
+ *
+ * Indices are handed out dynamically, so uneven tasks balance themselves.
+ * The calling thread works too. The first exception thrown by a task stops
+ * the remaining work and is rethrown on the caller.
+ */
+template <typename F>
+void for_each_index(size_t n, F&& f, unsigned threads = 0) {
+    if (threads == 0) threads = default_threads();
+    size_t workers = std::min<size_t>(threads, n);
+    if (workers <= 1) {
+        for (size_t i = 0; i < n; ++i) f(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&]() {
+        for (;;) {
+            size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= n) return;
+            try {
+                f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+                next.store(n, std::memory_order_relaxed);
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t t = 1; t < workers; ++t) pool.emplace_back(work);
+    work();
+    for (std::thread& t : pool) t.join();
+
+    if (error) std::rethrow_exception(error);
+}
+
+}  // namespace parallel
@@ -0,0 +1,56 @@
+/**
+ * @file parquet_io.hpp
+ * @brief Shared helpers for parallel Parquet reading.
+ */
+
+#pragma once
+
+#include <parquet/arrow/reader.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace parquet_io {
+
+/**
+ * @brief Run of consecutive row groups of one file and its slot in the merged output.
+ */
+struct RowGroupRun {
+    size_t file;
+    int first_group;
+    int num_groups;
+    size_t first_row;
+    size_t num_rows;
+};
+
+/**
+ * @brief Open a Parquet file for Arrow reading, without internal threads.
+ *
+ * Parallelism comes from decoding row groups concurrently. Throws on error.
+ */
+std::unique_ptr<parquet::arrow::FileReader> open(const std::string& path);
+
+/**
+ * @brief A single file, or the .parquet files of a directory in name order.
+ */
+std::vector<std::string> list_files(const std::string& path);
+
+/**
+ * @brief Split files into runs of row groups, about four per thread.
+ *
+ * Footers are read in parallel; row counts come from them, so every run
+ * knows its output slot up front. Runs are in (file, row group) order.
+ * @param total_rows Set to the row count over all files
+ */
+std::vector<RowGroupRun> plan_runs(const std::vector<std::string>& files, size_t& total_rows);
+
+/**
+ * @brief Leaf column indices of the named columns, in the given order.
+ *
+ * Throws if a column is missing.
+ */
+std::vector<int> column_indices(parquet::arrow::FileReader& reader, const std::vector<const char*>& names);
+
+}  // namespace parquet_io
@@ -0,0 +1,380 @@
+/**
+ * @file query_context.hpp
+ * @brief Reusable search state for ShortcutGraph queries.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Priority queue entry.
+ */
+struct PQEntry {
+    double dist;
+    uint32_t edge;
+    bool operator>(const PQEntry& o) const { return dist > o.dist; }
+};
+
+/**
+ * @brief Heap operation counters, accumulated until reset.
+ */
+struct HeapStats {
+    uint64_t pushes = 0;
+    uint64_t decreases = 0;  ///< decrease-key on an entry already queued
+    uint64_t pops = 0;
+    size_t max_size = 0;     ///< Largest heap size seen
+
+    HeapStats& operator+=(const HeapStats& o) {
+        pushes += o.pushes;
+        decreases += o.decreases;
+        pops += o.pops;
+        max_size = std::max(max_size, o.max_size);
+        return *this;
+    }
+};
+
+/**
+ * @brief Addressable 4-ary min-heap over dense edge indices.
+ *
+ * Each index is queued at most once; a shorter distance for a queued index
+ * moves its entry up instead of adding a duplicate. Positions are kept in
+ * an array indexed by edge, reset entry by entry in clear(), so clearing
+ * costs the number of queued entries rather than the graph size.
+ */
+class IndexedHeap {
+public:
+    /**
+     * @brief Make room for indices below @p edge_count.
+     */
+    void reserve_index(size_t edge_count) {
+        if (pos_.size() < edge_count) pos_.resize(edge_count, NONE);
+    }
+
+    bool empty() const { return entries_.empty(); }
+    size_t size() const { return entries_.size(); }
+    const PQEntry& top() const { return entries_.front(); }
+
+    bool contains(uint32_t edge) const { return pos_[edge] != NONE; }
+
+    /**
+     * @brief Insert @p edge, or lower its key if already queued.
+     *
+     * A key that is not lower than the queued one is ignored.
+     */
+    void push_or_decrease(uint32_t edge, double dist) {
+        uint32_t i = pos_[edge];
+        if (i == NONE) {
+            ++stats_.pushes;
+            i = static_cast<uint32_t>(entries_.size());
+            entries_.push_back({dist, edge});
+            stats_.max_size = std::max(stats_.max_size, entries_.size());
+        } else {
+            if (dist >= entries_[i].dist) return;
+            ++stats_.decreases;
+            entries_[i].dist = dist;
+        }
+        sift_up(i);
+    }
+
+    PQEntry pop() {
+        ++stats_.pops;
+        PQEntry top = entries_.front();
+        pos_[top.edge] = NONE;
+        PQEntry last = entries_.back();
+        entries_.pop_back();
+        if (!entries_.empty()) {
+            entries_[0] = last;
+            sift_down(0);
+        }
+        return top;
+    }
+
+    void clear() {
+        for (const PQEntry& e : entries_) pos_[e.edge] = NONE;
+        entries_.clear();
+    }
+
+    const HeapStats& stats() const { return stats_; }
+    void reset_stats() { stats_ = {}; }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr uint32_t ARITY = 4;
+
+    void place(uint32_t i, const PQEntry& e) {
+        entries_[i] = e;
+        pos_[e.edge] = i;
+    }
+
+    void sift_up(uint32_t i) {
+        PQEntry e = entries_[i];
+        while (i > 0) {
+            uint32_t parent = (i - 1) / ARITY;
+            if (!(entries_[parent].dist > e.dist)) break;
+            place(i, entries_[parent]);
+            i = parent;
+        }
+        place(i, e);
+    }
+
+    void sift_down(uint32_t i) {
+        PQEntry e = entries_[i];
+        uint32_t n = static_cast<uint32_t>(entries_.size());
+        for (;;) {
+            uint32_t first = i * ARITY + 1;
+            if (first >= n) break;
+            uint32_t last = std::min(first + ARITY, n);
+            uint32_t best = first;
+            for (uint32_t c = first + 1; c < last; ++c) {
+                if (entries_[c].dist < entries_[best].dist) best = c;
+            }
+            if (!(e.dist > entries_[best].dist)) break;
+            place(i, entries_[best]);
+            i = best;
+        }
+        place(i, e);
+    }
+
+    std::vector<PQEntry> entries_;
+    std::vector<uint32_t> pos_;  ///< Heap slot per edge, NONE if not queued
+    HeapStats stats_;
+};
+
+/**
+ * @brief Monotone radix heap over integer keys.
+ *
+ * Keys pushed must not be below the last popped key, which holds for
+ * Dijkstra with non-negative integer costs. Entries are not addressable;
+ * callers skip stale pops by comparing against their labels.
+ */
+class RadixHeap {
+public:
+    struct Entry {
+        uint64_t key;
+        uint32_t edge;
+    };
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    void push(uint64_t key, uint32_t edge) {
+        buckets_[bucket(key)].push_back({key, edge});
+        ++size_;
+    }
+
+    /**
+     * @brief Smallest key; the heap must not be empty.
+     */
+    uint64_t min_key() {
+        refill();
+        return last_;
+    }
+
+    Entry pop() {
+        refill();
+        Entry e = buckets_[0].back();
+        buckets_[0].pop_back();
+        --size_;
+        return e;
+    }
+
+    void clear() {
+        for (auto& b : buckets_) b.clear();
+        size_ = 0;
+        last_ = 0;
+    }
+
+private:
+    // Bucket 0 holds keys equal to last_; bucket b holds keys whose highest
+    // bit differing from last_ is bit b - 1
+    size_t bucket(uint64_t key) const { return key == last_ ? 0 : 64 - __builtin_clzll(key ^ last_); }
+
+    // Make bucket 0 non-empty by redistributing the first non-empty bucket
+    // around its minimum; every entry moves to a strictly lower bucket
+    void refill() {
+        if (!buckets_[0].empty()) return;
+        size_t b = 1;
+        while (buckets_[b].empty()) ++b;
+        uint64_t m = buckets_[b][0].key;
+        for (const Entry& e : buckets_[b]) m = std::min(m, e.key);
+        last_ = m;
+        for (const Entry& e : buckets_[b]) buckets_[bucket(e.key)].push_back(e);
+        buckets_[b].clear();
+    }
+
+    std::vector<Entry> buckets_[65];
+    size_t size_ = 0;
+    uint64_t last_ = 0;
+};
+
+/**
+ * @brief Distance labels and heap of one search direction.
+ *
+ * Labels are stamped with a generation counter: a label belongs to the
+ * current query only if its stamp matches, so starting a new query is O(1).
+ */
+class SearchSpace {
+public:
+    /**
+     * @brief Grow to @p edge_count labels if needed and start a new query.
+     */
+    void prepare(size_t edge_count) {
+        if (labels_.size() < edge_count) labels_.resize(edge_count);
+        heap.reserve_index(edge_count);
+        if (++generation_ == 0) {
+            // Stamp wrapped around: invalidate everything once
+            for (Label& l : labels_) l.stamp = 0;
+            generation_ = 1;
+        }
+        heap.clear();
+        radix.clear();
+    }
+
+    bool reached(uint32_t v) const { return labels_[v].stamp == generation_; }
+
+    double dist(uint32_t v) const {
+        return reached(v) ? labels_[v].dist : std::numeric_limits<double>::infinity();
+    }
+
+    uint32_t parent(uint32_t v) const { return labels_[v].parent; }
+
+    void set(uint32_t v, double dist, uint32_t parent) { labels_[v] = {dist, parent, generation_}; }
+
+    /**
+     * @brief Set a distance without a parent; parent(v) is then unspecified.
+     */
+    void set_dist(uint32_t v, double dist) {
+        labels_[v].dist = dist;
+        labels_[v].stamp = generation_;
+    }
+
+    IndexedHeap heap;
+    RadixHeap radix;  ///< Used by the quantized-cost queries only
+
+private:
+    struct Label {
+        double dist = 0.0;
+        uint32_t parent = 0;
+        uint32_t stamp = 0;
+    };
+
+    std::vector<Label> labels_;
+    uint32_t generation_ = 0;
+};
+
+/**
+ * @brief Scratch stack and optional memo for path unpacking.
+ *
+ * The memo maps a shortcut's arc slot to its expansion into base edges. It
+ * is off until set_capacity() is given a non-zero budget of stored edges;
+ * when the budget is reached the memo is emptied and refilled. Entries are
+ * tied to one graph layout and dropped when another layout binds.
+ */
+class UnpackCache {
+public:
+    struct Hop {
+        uint32_t from;
+        uint32_t to;
+        uint32_t depth;
+    };
+    std::vector<Hop> stack;  ///< Scratch for the iterative expansion
+
+    void set_capacity(size_t edges) {
+        capacity_ = edges;
+        clear();
+    }
+
+    bool enabled() const { return capacity_ > 0; }
+
+    /**
+     * @brief Use the memo for graph layout @p layout, clearing it on change.
+     */
+    void bind(uint64_t layout) {
+        if (layout != layout_) {
+            clear();
+            layout_ = layout;
+        }
+    }
+
+    /**
+     * @brief Append the memoized expansion of @p arc to @p out, if present.
+     */
+    bool append(uint32_t arc, std::vector<uint32_t>& out) {
+        auto it = index_.find(arc);
+        if (it == index_.end()) {
+            ++misses_;
+            return false;
+        }
+        ++hits_;
+        const uint32_t* first = storage_.data() + it->second.first;
+        out.insert(out.end(), first, first + it->second.second);
+        return true;
+    }
+
+    void insert(uint32_t arc, const uint32_t* edges, size_t count) {
+        if (count > capacity_) return;
+        if (storage_.size() + count > capacity_) clear();
+        index_[arc] = {static_cast<uint32_t>(storage_.size()), static_cast<uint32_t>(count)};
+        storage_.insert(storage_.end(), edges, edges + count);
+    }
+
+    void clear() {
+        index_.clear();
+        storage_.clear();
+    }
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+    void reset_stats() { hits_ = misses_ = 0; }
+
+private:
+    std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> index_;  // arc -> (offset, count)
+    std::vector<uint32_t> storage_;
+    size_t capacity_ = 0;
+    uint64_t layout_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+/**
+ * @brief Per-thread scratch state for queries.
+ *
+ * Keep one context per worker thread and pass it to the query overloads;
+ * after the first few queries no search state is allocated anymore.
+ * A context may be shared between graphs but not between threads.
+ */
+class QueryContext {
+public:
+    SearchSpace fwd;
+    SearchSpace bwd;
+    UnpackCache unpack;
+    std::vector<double> lanes;  ///< Sweep labels of the one-to-all queries, K per edge when batched
+
+    /**
+     * @brief Start a new query over a graph with @p edge_count indexed edges.
+     */
+    void prepare(size_t edge_count) {
+        fwd.prepare(edge_count);
+        bwd.prepare(edge_count);
+    }
+
+    /**
+     * @brief Heap counters of both directions since the last reset.
+     */
+    HeapStats heap_stats() const {
+        HeapStats s = fwd.heap.stats();
+        s += bwd.heap.stats();
+        return s;
+    }
+
+    void reset_heap_stats() {
+        fwd.heap.reset_stats();
+        bwd.heap.reset_stats();
+    }
+};
@@ -5,9 +5,13 @@
 
 #pragma once
 
+#include "mapped_vector.hpp"
+#include "query_context.hpp"
+#include "shortcut_index.hpp"
+
 #include <cstdint>
+#include <limits>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 /**
@@ -17,6 +21,16 @@ struct QueryResult {
     double distance;              ///< Total path cost
     std::vector<uint32_t> path;   ///< Sequence of edge IDs
     bool reachable;               ///< True if a path was found
+    double length = 0.0;          ///< Total base edge length, without unpacking
+};
+
+/**
+ * @brief Result of a distance-only query.
+ */
+struct DistanceResult {
+    double distance;        ///< Total path cost
+    uint32_t meeting_edge;  ///< Edge ID where the two searches met
+    bool reachable;         ///< True if a path was found
 };
 
 /**
@@ -39,7 +53,7 @@ struct EdgeMeta {
 };
 
 /**
- * @brief Shortcut edge in the graph.
+ * @brief Shortcut row as read from Parquet; load-time staging only.
  */
 struct Shortcut {
     uint32_t from;       ///< Source edge ID
@@ -50,6 +64,89 @@ struct Shortcut {
     int8_t inside;       ///< Direction: +1 up, 0 lateral, -1 down, -2 edge
 };
 
+/**
+ * @brief Adjacency entry of the CSR graph, stored inline for the query loops.
+ *
+ * Costs are stored as float to halve the arc footprint; distances are still
+ * accumulated in double.
+ */
+struct Arc {
+    uint32_t target;     ///< Dense index of the adjacent edge
+    float cost;          ///< Traversal cost
+};
+static_assert(sizeof(Arc) == 8, "Arc must stay packed");
+
+/**
+ * @brief Compressed sparse row adjacency over dense edge indices.
+ *
+ * Arcs of each node are split into `parts` consecutive classes. Class p of
+ * node i is arcs[offsets[i * parts + p] .. offsets[i * parts + p + 1]), so
+ * any run of adjacent classes is a single contiguous range.
+ */
+struct CsrGraph {
+    uint32_t parts = 1;
+    MappedVector<uint32_t> offsets;
+    MappedVector<Arc> arcs;
+
+    // Cold per-arc data, parallel to arcs; never read by the query loops
+    MappedVector<uint32_t> via_edge;  ///< Intermediate edge ID (0 if direct)
+    MappedVector<uint64_t> cell;      ///< H3 cell bounding the shortcut
+    MappedVector<double> length;      ///< Base edge length summed along via_edge
+
+    MappedVector<uint32_t> qcost;     ///< Quantized costs, only in quantized mode
+
+    size_t node_count() const { return offsets.empty() ? 0 : (offsets.size() - 1) / parts; }
+    const Arc* begin(uint32_t node, uint32_t part = 0) const { return arcs.data() + offsets[node * parts + part]; }
+    const Arc* end(uint32_t node, uint32_t part = 0) const { return arcs.data() + offsets[node * parts + part + 1]; }
+};
+
+/**
+ * @brief Arc classes of the backward graph, in storage order.
+ *
+ * The forward graph holds only `inside == +1` arcs in a single class.
+ */
+enum BwdPart : uint32_t {
+    BWD_DOWN = 0,     ///< inside == -1
+    BWD_LATERAL = 1,  ///< inside == 0
+    BWD_OUTER = 2,    ///< inside == -2
+    BWD_PARTS = 3
+};
+
+/**
+ * @brief Indexed edges grouped by their incoming H3 cell at one resolution.
+ *
+ * Built by ShortcutGraph::cell_grouping and reused across the aggregated
+ * one-to-all queries; their value tables follow the order of cells.
+ */
+struct CellGrouping {
+    static constexpr uint32_t NO_CELL = UINT32_MAX;
+
+    int res = -1;                 ///< Aggregation resolution
+    std::vector<uint64_t> cells;  ///< Distinct cells, ascending
+    std::vector<uint32_t> slot;   ///< Dense index -> position in cells, NO_CELL without metadata
+};
+
+/**
+ * @brief Per-cell reduction of one-to-all distances.
+ */
+enum class CellReduce {
+    MIN_DISTANCE,  ///< Smallest distance to an edge of the cell, -1 if none within cutoff
+    COUNT_WITHIN   ///< Number of edges of the cell within cutoff
+};
+
+/**
+ * @brief Edge metadata stored column-wise by dense index.
+ */
+struct EdgeColumns {
+    MappedVector<uint64_t> incoming_cell;
+    MappedVector<uint64_t> outgoing_cell;
+    MappedVector<int32_t> lca_res;
+    MappedVector<double> length;
+    MappedVector<double> cost;
+    MappedVector<uint8_t> present;  ///< 1 if the edge has metadata
+    MappedVector<uint64_t> lca_cell;  ///< incoming_cell truncated to lca_res; 0 without metadata
+};
+
 /**
  * @brief H3-based hierarchical routing graph.
  */
@@ -63,21 +160,49 @@ public:
     bool load_shortcuts(const std::string& path);
 
     /**
-     * @brief Load edge metadata from CSV.
-     * @param path Path to CSV file
+     * @brief Load edge metadata from CSV or Parquet.
+     *
+     * A directory or a .parquet file is read as Parquet with columns
+     * selected by name; anything else is parsed as CSV.
+     * @param path Path to CSV file, Parquet file or Parquet directory
      * @return true if successful
      */
     bool load_edge_metadata(const std::string& path);
 
+    /**
+     * @brief Write the loaded graph as a binary snapshot.
+     * @param path Output file (written atomically via rename)
+     * @return true if successful
+     */
+    bool save_snapshot(const std::string& path) const;
+
+    /**
+     * @brief Open a snapshot written by save_snapshot via mmap.
+     *
+     * Arrays are used in place; nothing is parsed or copied. Part counts,
+     * sizes, offsets, arc targets and costs, and index slots are checked in
+     * one pass, so a
+     * corrupt file cannot send queries out of bounds or into a loop.
+     * Replaces any previously loaded data.
+     * @param path Snapshot file
+     * @param verify Recompute payload checksums (reads the whole file)
+     * @return true if successful
+     */
+    bool load_snapshot(const std::string& path, bool verify = false);
+
     /**
      * @brief Classic bidirectional Dijkstra with inside filtering.
+     *
+     * Overloads without a QueryContext use a thread-local one.
      */
     QueryResult query_classic(uint32_t source_edge, uint32_t target_edge) const;
+    QueryResult query_classic(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const;
 
     /**
      * @brief Pruned bidirectional Dijkstra with H3 parent_check.
      */
     QueryResult query_pruned(uint32_t source_edge, uint32_t target_edge) const;
+    QueryResult query_pruned(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const;
 
     /**
      * @brief Multi-source/target bidirectional search.
@@ -88,12 +213,196 @@ public:
         const std::vector<uint32_t>& target_edges,
         const std::vector<double>& target_dists
     ) const;
+    QueryResult query_multi(
+        const std::vector<uint32_t>& source_edges,
+        const std::vector<double>& source_dists,
+        const std::vector<uint32_t>& target_edges,
+        const std::vector<double>& target_dists,
+        QueryContext& ctx
+    ) const;
+
+    /**
+     * @brief Expand a shortcut-level path into base road edges.
+     *
+     * Each hop (from, to) is looked up in a hash index and split at its
+     * via_edge into (from, via) and (via, to), recursively, until a hop has
+     * no shortcut record or no via edge (0 or one of its endpoints).
+     * ctx.unpack serves as scratch and, if given a capacity, as memo.
+     */
+    std::vector<uint32_t> unpack_path(const std::vector<uint32_t>& path) const;
+    std::vector<uint32_t> unpack_path(const std::vector<uint32_t>& path, QueryContext& ctx) const;
+
+    /**
+     * @brief Distance-only variants of query_classic, query_pruned and query_multi.
+     *
+     * Same searches without parent bookkeeping or path reconstruction; only
+     * the cost and the meeting edge are returned.
+     */
+    DistanceResult distance_classic(uint32_t source_edge, uint32_t target_edge) const;
+    DistanceResult distance_classic(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const;
+    DistanceResult distance_pruned(uint32_t source_edge, uint32_t target_edge) const;
+    DistanceResult distance_pruned(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const;
+    DistanceResult distance_multi(
+        const std::vector<uint32_t>& source_edges,
+        const std::vector<double>& source_dists,
+        const std::vector<uint32_t>& target_edges,
+        const std::vector<double>& target_dists
+    ) const;
+    DistanceResult distance_multi(
+        const std::vector<uint32_t>& source_edges,
+        const std::vector<double>& source_dists,
+        const std::vector<uint32_t>& target_edges,
+        const std::vector<double>& target_dists,
+        QueryContext& ctx
+    ) const;
+
+    /**
+     * @brief Many-to-many distances under the classic search's arc rules.
+     *
+     * One exhaustive backward search per target (down and lateral arcs)
+     * leaves (target, distance) buckets on every edge it settles; one
+     * exhaustive upward search per source then scans the buckets of the
+     * edges it settles. Each phase runs in parallel, across targets and then
+     * across sources.
+     * @param threads Worker count, 0 for all hardware threads
+     * @return Row-major sources x targets matrix; entry (i, j) equals
+     *         distance_classic(source_edges[i], target_edges[j]).distance,
+     *         -1 if unreachable or either edge is unknown
+     */
+    std::vector<double> distance_matrix(
+        const std::vector<uint32_t>& source_edges,
+        const std::vector<uint32_t>& target_edges,
+        unsigned threads = 0
+    ) const;
+
+    /**
+     * @brief Distances from a source to every indexed edge (PHAST-style).
+     *
+     * An upward search from the source (inside == +1) is followed by one
+     * linear sweep over all down and lateral arcs in a precomputed
+     * topological order, so every edge gets its exact classic distance
+     * without a heap. Groups of edges on a lateral cycle share one block
+     * of the order and are swept until stable.
+     * @param cutoff Distances above it are reported as -1; also bounds the
+     *        upward search
+     * @return Distance per dense index (see edge_id_at), -1 if unreachable;
+     *         entry t equals distance_classic(source, edge_id_at(t))
+     */
+    std::vector<double> one_to_all(
+        uint32_t source_edge,
+        double cutoff = std::numeric_limits<double>::infinity()
+    ) const;
+
+    /**
+     * @brief Multi-source one_to_all: the minimum over sources of
+     *        source_dists[i] plus the distance from source_edges[i].
+     */
+    std::vector<double> one_to_all(
+        const std::vector<uint32_t>& source_edges,
+        const std::vector<double>& source_dists,
+        double cutoff = std::numeric_limits<double>::infinity()
+    ) const;
+    std::vector<double> one_to_all(
+        const std::vector<uint32_t>& source_edges,
+        const std::vector<double>& source_dists,
+        double cutoff,
+        QueryContext& ctx
+    ) const;
+
+    /**
+     * @brief one_to_all for many sources, K sources per sweep.
+     *
+     * Each edge carries K labels, one per source, and the sweep relaxes
+     * them together with vector min/add, so one pass over the sweep arcs
+     * serves K sources. K = 4 fills an AVX2 register of doubles, 8 an
+     * AVX-512 one; 4, 8 and 16 are instantiated.
+     * @param threads Worker count over batches of K sources, 0 for all
+     *        hardware threads
+     * @return Row-major sources x dense index matrix; row i equals
+     *         one_to_all(source_edges[i], cutoff), all -1 for unknown sources
+     */
+    template <unsigned K = 8>
+    std::vector<double> one_to_all_many(
+        const std::vector<uint32_t>& source_edges,
+        double cutoff = std::numeric_limits<double>::infinity(),
+        unsigned threads = 0
+    ) const;
+
+    /**
+     * @brief Group edges by incoming_cell truncated to resolution @p res.
+     *
+     * Cells coarser than res are kept as they are. Rebuild after loading
+     * other data.
+     */
+    CellGrouping cell_grouping(int res) const;
+
+    /**
+     * @brief Multi-source one_to_all reduced per cell on the fly.
+     *
+     * Distances are folded into their edge's cell as the sweep emits them,
+     * so no per-edge array is returned.
+     * @return One value per cells.cells entry (see CellReduce)
+     */
+    std::vector<double> one_to_all_cells(
+        const std::vector<uint32_t>& source_edges,
+        const std::vector<double>& source_dists,
+        const CellGrouping& cells,
+        CellReduce reduce,
+        double cutoff = std::numeric_limits<double>::infinity()
+    ) const;
+
+    /**
+     * @brief one_to_all_many reduced per cell: row i is
+     *        one_to_all_cells({source_edges[i]}, {0}, cells, reduce, cutoff).
+     * @return Row-major sources x cells.cells matrix
+     */
+    template <unsigned K = 8>
+    std::vector<double> one_to_all_cells_many(
+        const std::vector<uint32_t>& source_edges,
+        const CellGrouping& cells,
+        CellReduce reduce,
+        double cutoff = std::numeric_limits<double>::infinity(),
+        unsigned threads = 0
+    ) const;
+
+    /**
+     * @brief Enable the quantized-cost search mode.
+     *
+     * Arc costs are rounded to multiples of @p resolution and kept as uint32
+     * next to the float costs for query_classic_quantized. The setting is
+     * reapplied after every load; 0 disables it and frees the arrays.
+     */
+    void set_cost_resolution(double resolution);
+    double cost_resolution() const { return cost_resolution_; }
+
+    /**
+     * @brief Classic bidirectional search on quantized costs with a radix heap.
+     *
+     * Requires set_cost_resolution. The distance is a sum of rounded costs,
+     * within half the resolution per path edge of query_classic.
+     */
+    QueryResult query_classic_quantized(uint32_t source_edge, uint32_t target_edge) const;
+    QueryResult query_classic_quantized(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const;
 
     /**
      * @brief Get edge cost.
      */
     double get_edge_cost(uint32_t edge_id) const;
 
+    /**
+     * @brief Get edge length.
+     */
+    double get_edge_length(uint32_t edge_id) const;
+
+    /**
+     * @brief Base length of a shortcut-level path, without unpacking it.
+     *
+     * Sums the precomputed per-shortcut lengths of its hops plus the length
+     * of the last edge; equal to the summed length of unpack_path(path).
+     * Hops deeper than the unpack depth limit are unpacked instead.
+     */
+    double path_length(const std::vector<uint32_t>& path) const;
+
     /**
      * @brief Get edge H3 cell.
      */
@@ -102,18 +411,98 @@ public:
     /**
      * @brief Get number of shortcuts loaded.
      */
-    size_t shortcut_count() const { return shortcuts_.size(); }
+    size_t shortcut_count() const { return shortcut_count_; }
 
     /**
      * @brief Get number of edges with metadata.
      */
-    size_t edge_count() const { return edge_meta_.size(); }
+    size_t edge_count() const { return meta_count_; }
+
+    /**
+     * @brief Get number of edges with a dense internal index.
+     *
+     * Every edge seen by load_shortcuts or load_edge_metadata is indexed.
+     */
+    size_t indexed_edge_count() const { return edge_ids_.size(); }
+
+    /**
+     * @brief Get the edge ID stored at a dense internal index.
+     */
+    uint32_t edge_id_at(uint32_t index) const { return edge_ids_[index]; }
 
 private:
-    HighCell compute_high_cell(uint32_t source_edge, uint32_t target_edge) const;
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+    static constexpr uint32_t MAX_UNPACK_DEPTH = 64;  // guards against via cycles in bad data
+
+    // Outcome of a search kernel; meeting is a dense index
+    struct SearchOutcome {
+        double distance;
+        uint32_t meeting;
+        bool found;
+    };
+    using PairSearch = SearchOutcome (ShortcutGraph::*)(uint32_t, uint32_t, QueryContext&) const;
+
+    // One search loop for all bidirectional modes; the filters pick the arcs
+    // a popped node expands per side, StopPolicy the meeting and stopping rule
+    template <typename ForwardFilter, typename BackwardFilter, typename StopPolicy, bool TrackParents>
+    SearchOutcome bidirectional_search(const ForwardFilter& forward, const BackwardFilter& backward,
+                                       const StopPolicy& stop, QueryContext& ctx) const;
+    template <bool TrackParents>
+    void seed_pair(uint32_t source, uint32_t target, QueryContext& ctx) const;
+
+    // TrackParents = false skips all parent writes (distance-only queries)
+    template <bool TrackParents>
+    SearchOutcome search_classic(uint32_t source, uint32_t target, QueryContext& ctx) const;
+    template <bool TrackParents>
+    SearchOutcome search_pruned(uint32_t source, uint32_t target, QueryContext& ctx) const;
+    template <bool TrackParents>
+    SearchOutcome search_multi(
+        const std::vector<uint32_t>& source_edges,
+        const std::vector<double>& source_dists,
+        const std::vector<uint32_t>& target_edges,
+        const std::vector<double>& target_dists,
+        QueryContext& ctx
+    ) const;
+    SearchOutcome search_classic_quantized(uint32_t source, uint32_t target, QueryContext& ctx) const;
+    template <typename Visit>
+    void settle_all(SearchSpace& space, const CsrGraph& csr, uint32_t first_part, uint32_t last_part,
+                    double limit, Visit&& visit) const;
+    template <typename Emit>
+    void sweep_from(const std::vector<uint32_t>& source_edges, const std::vector<double>& source_dists,
+                    double cutoff, QueryContext& ctx, Emit&& emit) const;
+    template <unsigned K, typename Emit>
+    void sweep_batch(const uint32_t* source_edges, size_t count, double cutoff, QueryContext& ctx,
+                     Emit&& emit) const;
+    QueryResult pair_path(uint32_t source_edge, uint32_t target_edge, PairSearch search, QueryContext& ctx) const;
+    DistanceResult pair_distance(uint32_t source_edge, uint32_t target_edge, PairSearch search,
+                                 QueryContext& ctx) const;
+
+    HighCell compute_high_cell(uint32_t source, uint32_t target) const;
+    uint32_t index_of(uint32_t edge_id) const;
+    void reindex(std::vector<uint32_t> edge_ids);
+    void build_csr(std::vector<Shortcut>& shortcuts);
+    std::vector<uint32_t> reconstruct_path(uint32_t meeting, const QueryContext& ctx) const;
+    void quantize_costs();
+    void build_shortcut_index();
+    std::vector<uint64_t> arc_keys() const;
+    void aggregate_lengths();
+    void build_sweep();
+    void build_lca_cells();
+    uint32_t via_of(uint32_t from, uint32_t to) const;
+    void unpack_hop(uint32_t from, uint32_t to, std::vector<uint32_t>& out, UnpackCache& cache) const;
+    uint64_t quantize(double cost) const;
 
-    std::vector<Shortcut> shortcuts_;
-    std::unordered_map<uint32_t, std::vector<size_t>> fwd_adj_;  // edge -> shortcut indices
-    std::unordered_map<uint32_t, std::vector<size_t>> bwd_adj_;
-    std::unordered_map<uint32_t, EdgeMeta> edge_meta_;
+    size_t shortcut_count_ = 0;
+    MappedVector<uint32_t> edge_ids_;  // dense index -> edge ID, sorted (binary search is the reverse map)
+    CsrGraph fwd_;  // from -> to, upward arcs only
+    CsrGraph bwd_;  // to -> from, partitioned by BwdPart
+    ShortcutIndex shortcut_index_;  // (from, to) -> arc slot; fwd arcs first, then bwd
+    uint64_t layout_id_ = 0;  // unique per built or loaded arc layout, keys unpack memos
+    CsrGraph sweep_;  // down and lateral arcs by head, in sweep order; targets are sweep positions
+    MappedVector<uint32_t> sweep_order_;     // sweep position -> dense index
+    MappedVector<uint32_t> sweep_position_;  // dense index -> sweep position
+    MappedVector<uint32_t> sweep_cyclic_;    // [begin, end) position pairs of groups on a cycle
+    EdgeColumns meta_;  // by dense index
+    size_t meta_count_ = 0;
+    double cost_resolution_ = 0.0;  // 0 = quantized mode off
 };
@@ -0,0 +1,73 @@
+/**
+ * @file shortcut_index.hpp
+ * @brief Open-addressing hash index from (from, to) edge IDs to shortcut arcs.
+ */
+
+#pragma once
+
+#include "mapped_vector.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Flat hash table mapping a shortcut's endpoint edge IDs to its arc slot.
+ *
+ * Keys are external edge IDs, so the index survives reindexing. Linear
+ * probing over a power-of-two table at most half full; the slot array is
+ * plain data and can live in a mapped snapshot.
+ */
+class ShortcutIndex {
+public:
+    struct Slot {
+        uint64_t key;       ///< from << 32 | to, EMPTY if unused
+        uint32_t arc;       ///< Global arc slot
+        uint32_t reserved;
+    };
+
+    static constexpr uint64_t EMPTY = UINT64_MAX;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    static uint64_t make_key(uint32_t from, uint32_t to) { return (uint64_t(from) << 32) | to; }
+
+    /**
+     * @brief Build from per-arc keys and costs; arc slot i has keys[i].
+     *
+     * For a repeated key the cheaper arc is kept, matching the arc a search
+     * relaxes.
+     */
+    void build(const std::vector<uint64_t>& keys, const std::vector<float>& costs) {
+        size_t capacity = 16;
+        while (capacity < 2 * keys.size()) capacity *= 2;
+        std::vector<Slot> table(capacity, Slot{EMPTY, NONE, 0});
+        for (size_t i = 0; i < keys.size(); ++i) {
+            Slot& s = table[probe(table.data(), capacity, keys[i])];
+            if (s.key == EMPTY) {
+                s = {keys[i], static_cast<uint32_t>(i), 0};
+            } else if (costs[i] < costs[s.arc]) {
+                s.arc = static_cast<uint32_t>(i);
+            }
+        }
+        slots = std::move(table);
+    }
+
+    /**
+     * @brief Arc slot of shortcut (from, to), or NONE.
+     */
+    uint32_t find(uint32_t from, uint32_t to) const {
+        if (slots.empty()) return NONE;
+        const Slot& s = slots[probe(slots.data(), slots.size(), make_key(from, to))];
+        return s.key == EMPTY ? NONE : s.arc;
+    }
+
+    MappedVector<Slot> slots;
+
+private:
+    // Slot holding key, or the empty slot where it would go
+    static size_t probe(const Slot* table, size_t capacity, uint64_t key) {
+        size_t mask = capacity - 1;
+        size_t s = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+        while (table[s].key != EMPTY && table[s].key != key) s = (s + 1) & mask;
+        return s;
+    }
+};
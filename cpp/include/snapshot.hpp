@@ -0,0 +1,149 @@
+/**
+ * @file snapshot.hpp
+ * @brief Versioned binary graph snapshot, opened through mmap.
+ *
+ * Layout: a fixed Header, a table of SectionEntry records, then one
+ * 64-byte-aligned payload per section. Payloads are raw little-endian
+ * arrays that are used in place, so opening a snapshot does no parsing.
+ */
+
+#pragma once
+
+#include "mapped_vector.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace snapshot {
+
+constexpr char MAGIC[8] = {'R', 'T', 'G', 'R', 'A', 'P', 'H', '\0'};
+constexpr uint32_t VERSION = 6;
+constexpr uint32_t ENDIAN_MARK = 0x01020304;
+constexpr uint64_t ALIGNMENT = 64;
+
+/**
+ * @brief Section identifiers. Values are part of the file format.
+ */
+enum SectionId : uint32_t {
+    GRAPH_INFO = 1,
+    EDGE_IDS = 2,
+    FWD_OFFSETS = 3,
+    FWD_ARCS = 4,
+    BWD_OFFSETS = 5,
+    BWD_ARCS = 6,
+    META_INCOMING_CELL = 7,
+    META_OUTGOING_CELL = 8,
+    META_LCA_RES = 9,
+    META_LENGTH = 10,
+    META_COST = 11,
+    META_PRESENT = 12,
+    FWD_VIA_EDGE = 13,
+    FWD_CELL = 14,
+    BWD_VIA_EDGE = 15,
+    BWD_CELL = 16,
+    SHORTCUT_INDEX = 17,
+    FWD_LENGTH = 18,
+    BWD_LENGTH = 19,
+    SWEEP_ORDER = 20,
+    SWEEP_POSITION = 21,
+    SWEEP_OFFSETS = 22,
+    SWEEP_ARCS = 23,
+    SWEEP_CYCLIC = 24,
+    META_LCA_CELL = 25,
+};
+
+/**
+ * @brief File header.
+ */
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;          ///< ENDIAN_MARK as written by the producer
+    uint64_t file_size;
+    uint32_t section_count;
+    uint32_t reserved;
+    uint64_t table_checksum;  ///< checksum() of the section table
+};
+
+/**
+ * @brief Section table entry.
+ */
+struct SectionEntry {
+    uint32_t id;
+    uint32_t elem_size;  ///< sizeof one element, checked on open
+    uint64_t offset;     ///< Byte offset of the payload from file start
+    uint64_t count;      ///< Number of elements
+    uint64_t checksum;   ///< checksum() of the payload
+};
+
+/**
+ * @brief 64-bit FNV-1a style hash over 8-byte words.
+ */
+uint64_t checksum(const void* data, size_t bytes);
+
+/**
+ * @brief Collects sections and writes a snapshot file.
+ *
+ * Section data is referenced, not copied, and must outlive write().
+ */
+class Writer {
+public:
+    template <typename T>
+    void add(uint32_t id, const T* data, size_t count) {
+        sections_.push_back({{id, static_cast<uint32_t>(sizeof(T)), 0, count, 0}, data});
+    }
+
+    bool write(const std::string& path) const;
+
+private:
+    struct Pending {
+        SectionEntry entry;
+        const void* data;
+    };
+    std::vector<Pending> sections_;
+};
+
+/**
+ * @brief Read-only memory mapping of a snapshot file.
+ */
+class Mapping {
+public:
+    /**
+     * @brief Map a snapshot and validate header and section table.
+     * @return nullptr if the file is missing, truncated or not a snapshot
+     */
+    static std::shared_ptr<const Mapping> open(const std::string& path);
+
+    ~Mapping();
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    const SectionEntry* find(uint32_t id) const;
+
+    /**
+     * @brief Recompute every payload checksum. Touches the whole file.
+     */
+    bool verify() const;
+
+    /**
+     * @brief View a section as an array; empty if absent or mistyped.
+     */
+    template <typename T>
+    static MappedVector<T> view(const std::shared_ptr<const Mapping>& m, uint32_t id) {
+        const SectionEntry* s = m->find(id);
+        if (!s || s->elem_size != sizeof(T)) return {};
+        return {m, reinterpret_cast<const T*>(m->base_ + s->offset), static_cast<size_t>(s->count)};
+    }
+
+private:
+    Mapping() = default;
+
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    const SectionEntry* table_ = nullptr;
+    uint32_t section_count_ = 0;
+};
+
+}  // namespace snapshot
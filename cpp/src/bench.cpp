@@ -0,0 +1,882 @@
+/**
+ * @file bench.cpp
+ * @brief Query benchmark over random source/target pairs.
+ */
+
+#include "h3_utils.hpp"
+#include "min_plus.hpp"
+#include "shortcut_graph.hpp"
+#include "snapshot.hpp"
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/writer.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <vector>
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "Options:\n"
+              << "  --shortcuts PATH   Path to shortcuts Parquet directory\n"
+              << "  --edges PATH       Path to edge metadata CSV or Parquet\n"
+              << "  --snapshot PATH    Binary snapshot from routing_prepare (replaces --shortcuts/--edges)\n"
+              << "  --synthetic N      Random graph of N edges and 7 N shortcuts instead of input\n"
+              << "                     files, written to a temporary directory and loaded from it\n"
+              << "  --queries N        Number of random queries (default: 1000)\n"
+              << "  --seed N           Random seed (default: 42)\n"
+              << "  --quantize RES     Also run the quantized-cost classic search at cost\n"
+              << "                     resolution RES (e.g. 0.001) and check it against classic\n"
+              << "  --matrix N         Also build an N x N distance matrix and spot-check it\n"
+              << "                     against classic-distance\n"
+              << "  --join N           Also time the min-plus bucket join on a synthetic\n"
+              << "                     N x N matrix, per kernel against scalar; needs no graph\n"
+              << "  --h3 N             Also check the bit-level H3 operations against libh3 on\n"
+              << "                     N random cells and time both; needs no graph\n"
+              << "  --multi-brute N    Also check query_multi and distance_multi against an\n"
+              << "                     exhaustive search on N small random graphs, with\n"
+              << "                     unequal source and target offsets; needs no graph\n"
+              << "  --edge-cases       Also check that degenerate inputs, such as edge metadata\n"
+              << "                     without shortcuts, give defined results; needs no graph\n"
+              << "  --cells RES        Also time per-cell minimum one-to-all at H3 resolution\n"
+              << "                     RES and check it against per-edge results\n"
+              << "  --help             Show this help\n"
+              << "Exits with status 1 if any check finds a mismatch.\n";
+}
+
+struct Stats {
+    double total_us = 0.0;
+    std::vector<double> samples;
+    size_t reachable = 0;
+};
+
+static void report(const char* name, Stats& s) {
+    std::sort(s.samples.begin(), s.samples.end());
+    size_t n = s.samples.size();
+    if (n == 0) return;
+    std::cout << name << ": " << n << " queries, "
+              << "avg " << s.total_us / n << " us, "
+              << "p50 " << s.samples[n / 2] << " us, "
+              << "p99 " << s.samples[std::min(n - 1, n * 99 / 100)] << " us, "
+              << s.reachable << " reachable\n";
+}
+
+// Size of a file, or of all files in a directory
+static uintmax_t input_bytes(const std::string& path) {
+    if (!std::filesystem::is_directory(path)) return std::filesystem::file_size(path);
+    uintmax_t bytes = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(path)) {
+        if (entry.is_regular_file()) bytes += entry.file_size();
+    }
+    return bytes;
+}
+
+static void report_heap(const HeapStats& h, size_t n) {
+    if (n == 0 || h.pushes == 0) return;
+    std::cout << "  heap: " << double(h.pushes) / n << " pushes, "
+              << double(h.decreases) / n << " decrease-keys, "
+              << double(h.pops) / n << " pops per query, "
+              << "peak " << h.max_size << " entries\n";
+}
+
+template <typename F>
+static void run(const char* name, size_t count, QueryContext& ctx, F&& query) {
+    Stats s;
+    ctx.reset_heap_stats();
+    for (size_t i = 0; i < count; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        auto r = query(i);
+        auto t1 = std::chrono::steady_clock::now();
+        double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+        s.total_us += us;
+        s.samples.push_back(us);
+        if (r.reachable) ++s.reachable;
+    }
+    report(name, s);
+    report_heap(ctx.heap_stats(), count);
+}
+
+// Bucket join of distance_matrix on synthetic search spaces: every row and
+// column settles JOIN_SETTLED random nodes out of JOIN_NODES. Returns the
+// number of kernels whose matrix differs from scalar
+static size_t run_join(size_t size, uint32_t seed) {
+    constexpr size_t JOIN_NODES = 20000;
+    constexpr size_t JOIN_SETTLED = 300;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> node(0, JOIN_NODES - 1);
+    std::uniform_real_distribution<double> dist(0.0, 1000.0);
+    auto space = [&] {
+        std::vector<std::pair<uint32_t, double>> s(JOIN_SETTLED);
+        for (auto& e : s) e = {node(rng), dist(rng)};
+        std::sort(s.begin(), s.end());
+        s.erase(std::unique(s.begin(), s.end(), [](const auto& a, const auto& b) { return a.first == b.first; }),
+                s.end());
+        return s;
+    };
+    std::vector<std::vector<std::pair<uint32_t, double>>> columns(size), rows(size);
+    for (auto& c : columns) c = space();
+    for (auto& r : rows) r = space();
+    min_plus::Buckets buckets = min_plus::build_buckets(JOIN_NODES, columns);
+
+    std::vector<min_plus::Kernel> kernels;
+    for (min_plus::Kernel kernel : {min_plus::Kernel::SCALAR, min_plus::Kernel::AVX2, min_plus::Kernel::AVX512}) {
+        if (min_plus::supported(kernel)) kernels.push_back(kernel);
+    }
+
+    std::vector<double> reference;
+    double scalar_ms = 0.0;
+    size_t mismatches = 0;
+    for (min_plus::Kernel kernel : kernels) {
+        std::vector<double> matrix(size * size, std::numeric_limits<double>::infinity());
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < size; ++i) {
+            min_plus::join_row(buckets, rows[i], matrix.data() + i * size, size, kernel);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        if (kernel == min_plus::Kernel::SCALAR) {
+            scalar_ms = ms;
+            reference = matrix;
+        }
+        std::cout << "join " << size << "x" << size << " " << min_plus::kernel_name(kernel) << ": " << ms << " ms ("
+                  << scalar_ms / ms << "x scalar)" << (matrix == reference ? "" : ", MISMATCH") << "\n";
+        if (matrix != reference) ++mismatches;
+    }
+    return mismatches;
+}
+
+// Bit-level h3_utils against libh3 on random cells: every parent, and the
+// LCA and parent check of pairs one to two kilometres apart. Returns the
+// mismatch count
+static size_t run_h3(size_t count, uint32_t seed) {
+    namespace h3 = h3_utils;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> lat(-85.0, 85.0), lng(-180.0, 180.0), near(-0.01, 0.01);
+    std::uniform_int_distribution<int> res(0, h3::MAX_RES);
+    std::vector<uint64_t> a(count), b(count);
+    std::vector<int> high_res(count);
+    for (size_t i = 0; i < count; ++i) {
+        double y = lat(rng), x = lng(rng);
+        a[i] = h3::libh3::lat_lng_to_cell(y, x, res(rng));
+        b[i] = h3::libh3::lat_lng_to_cell(y + near(rng), x + near(rng), res(rng));
+        high_res[i] = res(rng);
+    }
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (h3::get_resolution(a[i]) != h3::libh3::get_resolution(a[i])) ++mismatches;
+        for (int r = -1; r <= h3::MAX_RES; ++r) {
+            if (h3::cell_to_parent(a[i], r) != h3::libh3::cell_to_parent(a[i], r)) ++mismatches;
+        }
+        if (h3::find_lca(a[i], b[i]) != h3::libh3::find_lca(a[i], b[i])) ++mismatches;
+        uint64_t high = h3::libh3::cell_to_parent(b[i], high_res[i]);
+        int r = h3::libh3::get_resolution(high);
+        if (h3::parent_check(a[i], high, r) != h3::libh3::parent_check(a[i], high, r)) ++mismatches;
+    }
+    std::cout << "h3 bits vs libh3: " << count << " cells, " << mismatches << " mismatches\n";
+
+    auto time_ns = [&](const char* name, auto op) {
+        uint64_t sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) sink += op(i);
+        auto t1 = std::chrono::steady_clock::now();
+        std::cout << "  " << name << ": " << std::chrono::duration<double, std::nano>(t1 - t0).count() / count
+                  << " ns" << (sink == 42 ? " " : "") << "\n";
+    };
+    time_ns("find_lca bits", [&](size_t i) { return h3::find_lca(a[i], b[i]); });
+    time_ns("find_lca libh3", [&](size_t i) { return h3::libh3::find_lca(a[i], b[i]); });
+    // One high cell for all nodes, as within a pruned query
+    uint64_t high = h3::cell_to_parent(a[0], 3);
+    int high_r = h3::get_resolution(high);
+    time_ns("parent_check bits", [&](size_t i) { return h3::parent_check(b[i], high, high_r); });
+    time_ns("parent_check libh3", [&](size_t i) { return h3::libh3::parent_check(b[i], high, high_r); });
+    return mismatches;
+}
+
+template <typename Builder, typename T>
+static std::shared_ptr<arrow::Array> to_array(const std::vector<T>& values) {
+    Builder builder;
+    PARQUET_THROW_NOT_OK(builder.AppendValues(values));
+    std::shared_ptr<arrow::Array> array;
+    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+    return array;
+}
+
+static void write_parquet(const std::filesystem::path& path, const std::vector<std::string>& names,
+                          const std::vector<std::shared_ptr<arrow::Array>>& columns) {
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    for (size_t i = 0; i < names.size(); ++i) fields.push_back(arrow::field(names[i], columns[i]->type()));
+    std::shared_ptr<arrow::io::FileOutputStream> out;
+    PARQUET_ASSIGN_OR_THROW(out, arrow::io::FileOutputStream::Open(path.string()));
+    PARQUET_THROW_NOT_OK(parquet::arrow::WriteTable(*arrow::Table::Make(arrow::schema(fields), columns),
+                                                    arrow::default_memory_pool(), out, 4096));
+}
+
+// Random graph in the input formats, so checks can run without a dataset:
+// edges get random resolution 9 cells under one resolution 5 cell (built
+// from the digits, so no libh3 lookup), shortcuts random endpoints and a
+// parent of a random edge cell at resolution 5-9
+struct SyntheticGraph {
+    std::vector<int64_t> ids, incoming_cell, outgoing_cell;
+    std::vector<int8_t> lca_res;
+    std::vector<double> length, cost;
+    std::vector<int64_t> from, to, via, cell;
+    std::vector<double> shortcut_cost;
+    std::vector<int8_t> inside;
+};
+
+static SyntheticGraph make_synthetic(size_t edge_count, uint32_t seed) {
+    SyntheticGraph g;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    g.ids.resize(10 * edge_count);
+    std::iota(g.ids.begin(), g.ids.end(), 1);
+    std::shuffle(g.ids.begin(), g.ids.end(), rng);
+    g.ids.resize(edge_count);
+
+    auto random_cell = [&rng] {
+        uint64_t cell = h3_utils::cell_to_parent(0x8928308280fffff, 5);
+        cell = (cell & ~h3_utils::RES_MASK) | (uint64_t(9) << h3_utils::RES_OFFSET);
+        for (int res = 6; res <= 9; ++res) {
+            int shift = (h3_utils::MAX_RES - res) * h3_utils::DIGIT_BITS;
+            cell = (cell & ~(uint64_t(7) << shift)) | (uint64_t(rng() % 7) << shift);
+        }
+        return static_cast<int64_t>(cell);
+    };
+    const int8_t LCA_RES[] = {5, 6, 7, 8, 9, -1};
+    for (size_t i = 0; i < edge_count; ++i) {
+        g.incoming_cell.push_back(random_cell());
+        g.outgoing_cell.push_back(random_cell());
+        g.lca_res.push_back(LCA_RES[rng() % 6]);
+        g.cost.push_back(0.5 + 29.5 * unit(rng));
+        g.length.push_back(g.cost.back() * (5.0 + 10.0 * unit(rng)));
+    }
+
+    // Mostly upward arcs, as in real shortcut tables
+    const int8_t INSIDE[] = {1, 1, 1, 0, -1, -1, -2};
+    for (size_t i = 0; i < 7 * edge_count; ++i) {
+        int64_t from = g.ids[rng() % edge_count], to;
+        do to = g.ids[rng() % edge_count]; while (to == from);
+        g.from.push_back(from);
+        g.to.push_back(to);
+        g.via.push_back(g.ids[rng() % edge_count]);
+        g.shortcut_cost.push_back(1.0 + 199.0 * unit(rng));
+        g.cell.push_back(static_cast<int64_t>(
+            h3_utils::cell_to_parent(g.incoming_cell[rng() % edge_count], 5 + rng() % 5)));
+        g.inside.push_back(INSIDE[rng() % 7]);
+    }
+    return g;
+}
+
+// Load through the regular Parquet readers from a temporary directory,
+// removed afterwards; without shortcuts, only the edge metadata is loaded
+static bool load_synthetic(ShortcutGraph& graph, const SyntheticGraph& g, bool shortcuts = true) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                                ("routing_bench_" + std::to_string(std::random_device{}()));
+    std::filesystem::create_directories(dir / "shortcuts");
+    write_parquet(dir / "edges.parquet", {"id", "incoming_cell", "outgoing_cell", "lca_res", "length", "cost"},
+                  {to_array<arrow::Int64Builder>(g.ids), to_array<arrow::Int64Builder>(g.incoming_cell),
+                   to_array<arrow::Int64Builder>(g.outgoing_cell), to_array<arrow::Int8Builder>(g.lca_res),
+                   to_array<arrow::DoubleBuilder>(g.length), to_array<arrow::DoubleBuilder>(g.cost)});
+    write_parquet(dir / "shortcuts" / "part0.parquet",
+                  {"incoming_edge", "outgoing_edge", "cost", "via_edge", "cell", "inside"},
+                  {to_array<arrow::Int64Builder>(g.from), to_array<arrow::Int64Builder>(g.to),
+                   to_array<arrow::DoubleBuilder>(g.shortcut_cost), to_array<arrow::Int64Builder>(g.via),
+                   to_array<arrow::Int64Builder>(g.cell), to_array<arrow::Int8Builder>(g.inside)});
+
+    bool ok = (!shortcuts || graph.load_shortcuts((dir / "shortcuts").string())) &&
+              graph.load_edge_metadata((dir / "edges.parquet").string());
+    std::filesystem::remove_all(dir);
+    return ok;
+}
+
+// query_multi and distance_multi on small synthetic graphs against an
+// exhaustive Dijkstra over (edge, phase) states: phase 0 follows upward arcs
+// from every seeded source, phase 1 downward and lateral arcs into the
+// targets. KNN-style queries take 1-6 candidates per side with offsets 0-40;
+// every second query adds 100 to all offsets of one side, so the two sides'
+// seed floors differ. Returns the mismatch count
+static size_t run_multi_brute(size_t graphs, uint32_t seed) {
+    constexpr size_t EDGES = 400;
+    constexpr size_t QUERIES = 50;
+    constexpr double INF = std::numeric_limits<double>::infinity();
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, EDGES - 1), candidates(1, 6);
+    std::uniform_real_distribution<double> offset(0.0, 40.0);
+    QueryContext ctx;
+    size_t reachable = 0, mismatches = 0;
+
+    for (size_t g = 0; g < graphs; ++g) {
+        SyntheticGraph input = make_synthetic(EDGES, seed + static_cast<uint32_t>(g));
+        ShortcutGraph graph;
+        if (!load_synthetic(graph, input)) {
+            std::cerr << "Error: Failed to load synthetic graph\n";
+            return mismatches + 1;
+        }
+
+        // Arcs by edge ID, with costs rounded to float as the CSR stores them
+        size_t ids = 10 * EDGES + 1;
+        std::vector<std::vector<std::pair<uint32_t, double>>> up(ids), down(ids);
+        for (size_t i = 0; i < input.from.size(); ++i) {
+            double cost = static_cast<float>(input.shortcut_cost[i]);
+            if (input.inside[i] == 1) up[input.from[i]].push_back({static_cast<uint32_t>(input.to[i]), cost});
+            if (input.inside[i] == 0 || input.inside[i] == -1) {
+                down[input.from[i]].push_back({static_cast<uint32_t>(input.to[i]), cost});
+            }
+        }
+
+        for (size_t q = 0; q < QUERIES; ++q) {
+            std::vector<uint32_t> sources, targets;
+            std::vector<double> source_dists, target_dists;
+            for (size_t k = candidates(rng); k > 0; --k) {
+                sources.push_back(static_cast<uint32_t>(input.ids[pick(rng)]));
+                source_dists.push_back(offset(rng));
+            }
+            for (size_t k = candidates(rng); k > 0; --k) {
+                targets.push_back(static_cast<uint32_t>(input.ids[pick(rng)]));
+                target_dists.push_back(offset(rng));
+            }
+            if (q % 4 == 1) for (double& d : source_dists) d += 100.0;
+            if (q % 4 == 3) for (double& d : target_dists) d += 100.0;
+
+            // State 2 * edge + phase
+            std::vector<double> dist(2 * ids, INF), exit(ids, INF);
+            for (size_t i = 0; i < targets.size(); ++i) {
+                exit[targets[i]] = std::min(exit[targets[i]], target_dists[i] + graph.get_edge_cost(targets[i]));
+            }
+            using Entry = std::pair<double, uint32_t>;
+            std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+            for (size_t i = 0; i < sources.size(); ++i) heap.push({source_dists[i], 2 * sources[i]});
+            double expected = INF;
+            while (!heap.empty()) {
+                auto [d, state] = heap.top();
+                heap.pop();
+                if (d >= dist[state]) continue;
+                dist[state] = d;
+                uint32_t edge = state / 2;
+                if (state % 2 == 0) {
+                    heap.push({d, state + 1});
+                    for (const auto& [to, cost] : up[edge]) heap.push({d + cost, 2 * to});
+                } else {
+                    expected = std::min(expected, d + exit[edge]);
+                    for (const auto& [to, cost] : down[edge]) heap.push({d + cost, 2 * to + 1});
+                }
+            }
+
+            DistanceResult r = graph.distance_multi(sources, source_dists, targets, target_dists, ctx);
+            QueryResult path = graph.query_multi(sources, source_dists, targets, target_dists, ctx);
+            bool found = expected < INF;
+            double tolerance = 1e-9 * std::max(1.0, expected);
+            bool ok = r.reachable == found && path.reachable == found;
+            if (ok && found) {
+                ok = std::abs(r.distance - expected) <= tolerance && std::abs(path.distance - expected) <= tolerance &&
+                     !path.path.empty() &&
+                     std::find(sources.begin(), sources.end(), path.path.front()) != sources.end() &&
+                     std::find(targets.begin(), targets.end(), path.path.back()) != targets.end();
+            }
+            reachable += found;
+            if (!ok) ++mismatches;
+        }
+    }
+    std::cout << "multi vs brute force: " << graphs << " graphs, " << graphs * QUERIES << " queries, " << reachable
+              << " reachable, " << mismatches << " mismatches\n";
+    return mismatches;
+}
+
+// Degenerate inputs that must give defined results instead of reading out
+// of bounds. Returns the number of failed expectations
+static size_t run_edge_cases(uint32_t seed) {
+    SyntheticGraph input = make_synthetic(200, seed);
+    size_t failures = 0;
+    auto expect = [&](bool ok, const char* what) {
+        if (ok) return;
+        std::cout << "  failed: " << what << "\n";
+        ++failures;
+    };
+
+    // Edge metadata without shortcuts: distinct edges are unreachable
+    {
+        ShortcutGraph graph;
+        if (!load_synthetic(graph, input, false)) {
+            std::cerr << "Error: Failed to load synthetic edge metadata\n";
+            return failures + 1;
+        }
+        uint32_t a = static_cast<uint32_t>(input.ids[0]), b = static_cast<uint32_t>(input.ids[1]);
+        QueryContext ctx;
+        expect(!graph.query_classic(a, b, ctx).reachable, "metadata only: query_classic");
+        expect(!graph.query_pruned(a, b, ctx).reachable, "metadata only: query_pruned");
+        expect(!graph.query_classic_quantized(a, b, ctx).reachable, "metadata only: query_classic_quantized");
+        expect(!graph.query_multi({a}, {0.0}, {b}, {0.0}, ctx).reachable, "metadata only: query_multi");
+        expect(!graph.distance_classic(a, b, ctx).reachable, "metadata only: distance_classic");
+        expect(!graph.distance_pruned(a, b, ctx).reachable, "metadata only: distance_pruned");
+        expect(!graph.distance_multi({a}, {0.0}, {b}, {0.0}, ctx).reachable, "metadata only: distance_multi");
+        expect(graph.query_classic(a, a, ctx).reachable, "metadata only: query_classic to itself");
+        std::vector<double> dist = graph.one_to_all(a);
+        expect(std::count_if(dist.begin(), dist.end(), [](double d) { return d >= 0; }) == 1,
+               "metadata only: one_to_all reaches only its source");
+        expect(graph.distance_matrix({a}, {b}) == std::vector<double>{-1}, "metadata only: distance_matrix");
+    }
+
+    // Via structures deeper than the unpack limit: a chain (1, k) via k - 1
+    // for k up to 100, in order so every link is memoized before its parent,
+    // and a via cycle (201, 202) via 203, (201, 203) via 202. path_length must
+    // match the edges unpack_path produces
+    {
+        SyntheticGraph chain = make_synthetic(200, seed);
+        std::iota(chain.ids.begin(), chain.ids.end(), 1);
+        for (int64_t id : {201, 202, 203}) {
+            chain.ids.push_back(id);
+            chain.incoming_cell.push_back(chain.incoming_cell[0]);
+            chain.outgoing_cell.push_back(chain.outgoing_cell[0]);
+            chain.lca_res.push_back(-1);
+            chain.length.push_back(10.0);
+            chain.cost.push_back(1.0);
+        }
+        chain.from.clear();
+        chain.to.clear();
+        chain.via.clear();
+        chain.cell.clear();
+        chain.shortcut_cost.clear();
+        chain.inside.clear();
+        auto add = [&](int64_t from, int64_t to, int64_t via) {
+            chain.from.push_back(from);
+            chain.to.push_back(to);
+            chain.via.push_back(via);
+            chain.cell.push_back(chain.incoming_cell[0]);
+            chain.shortcut_cost.push_back(1.0);
+            chain.inside.push_back(1);
+        };
+        for (int64_t k = 2; k <= 100; ++k) add(1, k, k - 1);
+        add(201, 202, 203);
+        add(201, 203, 202);
+
+        ShortcutGraph graph;
+        if (!load_synthetic(graph, chain)) {
+            std::cerr << "Error: Failed to load synthetic via chain\n";
+            return failures + 1;
+        }
+        auto unpacked_length = [&](const std::vector<uint32_t>& path) {
+            double total = 0.0;
+            for (uint32_t e : graph.unpack_path(path)) total += graph.get_edge_length(e);
+            return total;
+        };
+        size_t wrong = 0;
+        for (uint32_t k = 2; k <= 100; ++k) {
+            double expected = unpacked_length({1, k});
+            if (std::abs(graph.path_length({1, k}) - expected) > 1e-9 * expected) ++wrong;
+        }
+        expect(wrong == 0, "via chain: path_length matches unpack_path");
+        double cycle = unpacked_length({201, 202});
+        expect(std::abs(graph.path_length({201, 202}) - cycle) <= 1e-9 * cycle,
+               "via cycle: path_length matches unpack_path");
+    }
+
+    // Snapshot with the forward and backward CSR sections swapped and the
+    // part counts swapped to match, checksums recomputed: every size agrees,
+    // but backward part lookups would read past the offsets
+    {
+        ShortcutGraph graph;
+        std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                     ("routing_bench_" + std::to_string(std::random_device{}()) + ".snap");
+        if (!load_synthetic(graph, input) || !graph.save_snapshot(path.string())) {
+            std::cerr << "Error: Failed to write synthetic snapshot\n";
+            return failures + 1;
+        }
+        expect(ShortcutGraph().load_snapshot(path.string(), true), "snapshot: unmodified file opens");
+
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        auto& header = *reinterpret_cast<snapshot::Header*>(bytes.data());
+        auto* table = reinterpret_cast<snapshot::SectionEntry*>(bytes.data() + sizeof(snapshot::Header));
+        const std::pair<uint32_t, uint32_t> SWAP[] = {
+            {snapshot::FWD_OFFSETS, snapshot::BWD_OFFSETS}, {snapshot::FWD_ARCS, snapshot::BWD_ARCS},
+            {snapshot::FWD_VIA_EDGE, snapshot::BWD_VIA_EDGE}, {snapshot::FWD_CELL, snapshot::BWD_CELL},
+            {snapshot::FWD_LENGTH, snapshot::BWD_LENGTH}};
+        for (uint32_t i = 0; i < header.section_count; ++i) {
+            snapshot::SectionEntry& e = table[i];
+            for (const auto& [fwd, bwd] : SWAP) {
+                if (e.id == fwd || e.id == bwd) {
+                    e.id = e.id == fwd ? bwd : fwd;
+                    break;
+                }
+            }
+            if (e.id == snapshot::GRAPH_INFO) {
+                // Two uint64 counts, then the forward and backward part counts
+                uint32_t* parts = reinterpret_cast<uint32_t*>(bytes.data() + e.offset + 16);
+                std::swap(parts[0], parts[1]);
+                e.checksum = snapshot::checksum(bytes.data() + e.offset, e.count * e.elem_size);
+            }
+        }
+        header.table_checksum = snapshot::checksum(table, header.section_count * sizeof(snapshot::SectionEntry));
+        std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size());
+        expect(!ShortcutGraph().load_snapshot(path.string(), true), "snapshot: swapped part counts are rejected");
+        std::filesystem::remove(path);
+    }
+
+    std::cout << "edge cases: " << failures << " failures\n";
+    return failures;
+}
+
+int main(int argc, char* argv[]) {
+    std::string shortcuts_path, edges_path, snapshot_path;
+    size_t num_queries = 1000;
+    uint32_t seed = 42;
+    double resolution = 0.0;
+    size_t matrix_size = 0;
+    size_t join_size = 0;
+    int cell_res = -1;
+    size_t h3_count = 0;
+    size_t synthetic_edges = 0;
+    size_t brute_graphs = 0;
+    bool edge_cases = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--shortcuts") == 0 && i + 1 < argc) {
+            shortcuts_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--edges") == 0 && i + 1 < argc) {
+            edges_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) {
+            synthetic_edges = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            num_queries = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--quantize") == 0 && i + 1 < argc) {
+            resolution = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "--matrix") == 0 && i + 1 < argc) {
+            matrix_size = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--join") == 0 && i + 1 < argc) {
+            join_size = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--h3") == 0 && i + 1 < argc) {
+            h3_count = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--multi-brute") == 0 && i + 1 < argc) {
+            brute_graphs = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--edge-cases") == 0) {
+            edge_cases = true;
+        } else if (std::strcmp(argv[i], "--cells") == 0 && i + 1 < argc) {
+            cell_res = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+
+    // Mismatches of the checks that fail the run. The join, H3, brute-force
+    // multi and edge-case checks need no input graph
+    size_t failures = 0;
+    if (join_size > 0) failures += run_join(join_size, seed);
+    if (h3_count > 0) failures += run_h3(h3_count, seed);
+    if (brute_graphs > 0) failures += run_multi_brute(brute_graphs, seed);
+    if (edge_cases) failures += run_edge_cases(seed);
+    if (synthetic_edges == 0 && snapshot_path.empty() && (shortcuts_path.empty() || edges_path.empty())) {
+        if (join_size > 0 || h3_count > 0 || brute_graphs > 0 || edge_cases) return failures > 0 ? 1 : 0;
+        std::cerr << "Error: --snapshot, --synthetic or --shortcuts and --edges are required\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    ShortcutGraph graph;
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (synthetic_edges > 0) {
+        if (!load_synthetic(graph, make_synthetic(synthetic_edges, seed))) {
+            std::cerr << "Error: Failed to load synthetic graph\n";
+            return 1;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        std::cout << "Synthetic: " << graph.shortcut_count() << " shortcuts, " << graph.edge_count() << " edges in "
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n\n";
+    } else if (!snapshot_path.empty()) {
+        if (!graph.load_snapshot(snapshot_path)) {
+            std::cerr << "Error: Failed to open snapshot\n";
+            return 1;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        std::cout << "Snapshot: " << graph.shortcut_count() << " shortcuts, " << graph.edge_count() << " edges in "
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n\n";
+    } else {
+        if (!graph.load_shortcuts(shortcuts_path)) {
+            std::cerr << "Error: Failed to load shortcuts\n";
+            return 1;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        if (!graph.load_edge_metadata(edges_path)) {
+            std::cerr << "Error: Failed to load edge metadata\n";
+            return 1;
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        std::cout << "Shortcuts: " << graph.shortcut_count() << " in "
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+        double edges_ms = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        double edges_mb = static_cast<double>(input_bytes(edges_path)) / (1024.0 * 1024.0);
+        std::cout << "Edges: " << graph.edge_count() << " in " << edges_ms << " ms ("
+                  << edges_mb / (edges_ms / 1000.0) << " MB/s)\n\n";
+    }
+
+    if (graph.indexed_edge_count() == 0) return failures > 0 ? 1 : 0;
+
+    // Random pairs over indexed edges, identical for every algorithm
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(graph.indexed_edge_count() - 1));
+    std::vector<std::pair<uint32_t, uint32_t>> pairs(num_queries);
+    for (auto& p : pairs) {
+        p = {graph.edge_id_at(pick(rng)), graph.edge_id_at(pick(rng))};
+    }
+
+    QueryContext ctx;
+    run("classic", pairs.size(), ctx, [&](size_t i) {
+        return graph.query_classic(pairs[i].first, pairs[i].second, ctx);
+    });
+    run("pruned", pairs.size(), ctx, [&](size_t i) {
+        return graph.query_pruned(pairs[i].first, pairs[i].second, ctx);
+    });
+
+    // Multi: three sources and three targets per query
+    std::vector<double> offsets = {0.0, 1.5, 3.0};
+    std::vector<std::vector<uint32_t>> multi_sources(pairs.size() / 3), multi_targets(pairs.size() / 3);
+    for (size_t i = 0; i < multi_sources.size(); ++i) {
+        for (size_t k = 0; k < 3; ++k) {
+            multi_sources[i].push_back(pairs[3 * i + k].first);
+            multi_targets[i].push_back(pairs[3 * i + k].second);
+        }
+    }
+    run("multi", multi_sources.size(), ctx, [&](size_t i) {
+        return graph.query_multi(multi_sources[i], offsets, multi_targets[i], offsets, ctx);
+    });
+
+    // Distance-only variants: no parent writes, no path
+    run("classic-distance", pairs.size(), ctx, [&](size_t i) {
+        return graph.distance_classic(pairs[i].first, pairs[i].second, ctx);
+    });
+    run("pruned-distance", pairs.size(), ctx, [&](size_t i) {
+        return graph.distance_pruned(pairs[i].first, pairs[i].second, ctx);
+    });
+    run("multi-distance", multi_sources.size(), ctx, [&](size_t i) {
+        return graph.distance_multi(multi_sources[i], offsets, multi_targets[i], offsets, ctx);
+    });
+
+    // Multi must match the best of its 3x3 classic pairs plus offsets
+    {
+        size_t mismatches = 0;
+        for (size_t i = 0; i < multi_sources.size(); ++i) {
+            double expected = std::numeric_limits<double>::infinity();
+            for (size_t a = 0; a < 3; ++a) {
+                for (size_t b = 0; b < 3; ++b) {
+                    DistanceResult r = graph.distance_classic(multi_sources[i][a], multi_targets[i][b], ctx);
+                    if (r.reachable) expected = std::min(expected, offsets[a] + r.distance + offsets[b]);
+                }
+            }
+            DistanceResult m = graph.distance_multi(multi_sources[i], offsets, multi_targets[i], offsets, ctx);
+            bool reachable = expected < std::numeric_limits<double>::infinity();
+            if (m.reachable != reachable ||
+                (reachable && std::abs(m.distance - expected) > 1e-9 * std::max(1.0, expected))) {
+                ++mismatches;
+            }
+        }
+        if (!multi_sources.empty()) {
+            std::cout << "multi check: " << multi_sources.size() << " queries, " << mismatches
+                      << " mismatches vs best classic pair\n";
+        }
+        failures += mismatches;
+    }
+
+    // Unpacking classic paths into base edges, without and with the memo
+    std::vector<std::vector<uint32_t>> paths;
+    for (const auto& [s, t] : pairs) {
+        QueryResult r = graph.query_classic(s, t, ctx);
+        if (r.reachable && !r.path.empty()) paths.push_back(std::move(r.path));
+    }
+    for (size_t capacity : {size_t(0), size_t(1) << 20}) {
+        ctx.unpack.set_capacity(capacity);
+        ctx.unpack.reset_stats();
+        size_t hops = 0, edges = 0;
+        double total_us = 0.0;
+        for (const auto& path : paths) {
+            auto t0 = std::chrono::steady_clock::now();
+            std::vector<uint32_t> base = graph.unpack_path(path, ctx);
+            auto t1 = std::chrono::steady_clock::now();
+            total_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            hops += path.size() - 1;
+            edges += base.size() - 1;
+        }
+        if (paths.empty()) break;
+        std::cout << (capacity ? "unpack (memo)" : "unpack") << ": avg " << total_us / paths.size() << " us, "
+                  << double(hops) / paths.size() << " hops -> " << double(edges) / paths.size() << " base edges";
+        uint64_t lookups = ctx.unpack.hits() + ctx.unpack.misses();
+        if (lookups > 0) std::cout << ", hit rate " << 100.0 * ctx.unpack.hits() / lookups << "%";
+        std::cout << "\n";
+    }
+    ctx.unpack.set_capacity(0);
+
+    // Route length from per-shortcut sums, as query_* fill QueryResult::length
+    if (!paths.empty()) {
+        double total_us = 0.0, checksum = 0.0;
+        for (const auto& path : paths) {
+            auto t0 = std::chrono::steady_clock::now();
+            checksum += graph.path_length(path);
+            auto t1 = std::chrono::steady_clock::now();
+            total_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+        }
+        std::cout << "path_length: avg " << total_us / paths.size() << " us, avg length "
+                  << checksum / paths.size() << " m\n";
+    }
+
+    // One-to-all sweeps, spot-checked against the pairwise search
+    {
+        size_t count = std::min<size_t>(pairs.size(), 20);
+        double total_ms = 0.0;
+        size_t reached = 0, mismatches = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto t0 = std::chrono::steady_clock::now();
+            std::vector<double> dist = graph.one_to_all(pairs[i].first);
+            auto t1 = std::chrono::steady_clock::now();
+            total_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+            reached += std::count_if(dist.begin(), dist.end(), [](double d) { return d >= 0; });
+            
+            for (size_t k = 0; k < 10; ++k) {
+                uint32_t t = pick(rng);
+                DistanceResult r = graph.distance_classic(pairs[i].first, graph.edge_id_at(t), ctx);
+                double expected = r.reachable ? r.distance : -1;
+                if (std::abs(dist[t] - expected) > 1e-9 * std::max(1.0, expected)) ++mismatches;
+            }
+        }
+        if (count > 0) {
+            std::cout << "one-to-all: " << count << " sources, avg " << total_ms / count << " ms, "
+                      << double(reached) / count << " edges reached, " << mismatches
+                      << " mismatches vs classic-distance\n";
+        }
+        failures += mismatches;
+    }
+
+    // K-lane one-to-all on one thread, per-source time against single sweeps
+    {
+        std::vector<uint32_t> sources;
+        for (size_t i = 0; i < std::min<size_t>(pairs.size(), 32); ++i) sources.push_back(pairs[i].first);
+        std::vector<std::vector<double>> single;
+        double single_ms = 0.0;
+        for (uint32_t s : sources) {
+            auto t0 = std::chrono::steady_clock::now();
+            single.push_back(graph.one_to_all(s));
+            auto t1 = std::chrono::steady_clock::now();
+            single_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        }
+        auto run_lanes = [&](unsigned lanes, auto sweep) {
+            auto t0 = std::chrono::steady_clock::now();
+            std::vector<double> rows = sweep();
+            auto t1 = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            size_t n = graph.indexed_edge_count(), mismatches = 0;
+            for (size_t i = 0; i < sources.size(); ++i) {
+                if (!std::equal(single[i].begin(), single[i].end(), rows.begin() + i * n)) ++mismatches;
+            }
+            std::cout << "one-to-all x" << lanes << ": " << ms / sources.size() << " ms per source ("
+                      << single_ms / ms << "x single), " << mismatches << " rows differ\n";
+            failures += mismatches;
+        };
+        if (!sources.empty()) {
+            std::cout << "one-to-all single: " << single_ms / sources.size() << " ms per source\n";
+            run_lanes(4, [&] { return graph.one_to_all_many<4>(sources, std::numeric_limits<double>::infinity(), 1); });
+            run_lanes(8, [&] { return graph.one_to_all_many<8>(sources, std::numeric_limits<double>::infinity(), 1); });
+            run_lanes(16, [&] { return graph.one_to_all_many<16>(sources, std::numeric_limits<double>::infinity(), 1); });
+        }
+    }
+
+    if (resolution > 0.0) {
+        graph.set_cost_resolution(resolution);
+        run("classic-quantized", pairs.size(), ctx, [&](size_t i) {
+            return graph.query_classic_quantized(pairs[i].first, pairs[i].second, ctx);
+        });
+        
+        // Rounding moves each path edge's cost by at most resolution / 2, so the
+        // two optima differ by at most that times the longer path's edge count
+        size_t mismatched = 0, violations = 0;
+        double max_error = 0.0;
+        for (const auto& [s, t] : pairs) {
+            QueryResult exact = graph.query_classic(s, t, ctx);
+            QueryResult quantized = graph.query_classic_quantized(s, t, ctx);
+            if (exact.reachable != quantized.reachable) {
+                ++mismatched;
+                continue;
+            }
+            if (!exact.reachable) continue;
+            double error = std::abs(exact.distance - quantized.distance);
+            double bound = std::max(exact.path.size(), quantized.path.size()) * resolution / 2 + 1e-6;
+            max_error = std::max(max_error, error);
+            if (error > bound) ++violations;
+        }
+        std::cout << "quantized vs classic: max |error| " << max_error << ", "
+                  << violations << " over bound, " << mismatched << " reachability mismatches\n";
+        failures += violations + mismatched;
+    }
+
+    if (matrix_size > 0) {
+        std::vector<uint32_t> sources(matrix_size), targets(matrix_size);
+        for (size_t i = 0; i < matrix_size; ++i) {
+            sources[i] = graph.edge_id_at(pick(rng));
+            targets[i] = graph.edge_id_at(pick(rng));
+        }
+        auto m0 = std::chrono::steady_clock::now();
+        std::vector<double> matrix = graph.distance_matrix(sources, targets);
+        auto m1 = std::chrono::steady_clock::now();
+        size_t reachable = std::count_if(matrix.begin(), matrix.end(), [](double d) { return d >= 0; });
+        std::cout << "matrix " << matrix_size << "x" << matrix_size << ": "
+                  << std::chrono::duration<double, std::milli>(m1 - m0).count() << " ms, "
+                  << reachable << " reachable\n";
+
+        // One entry per row, against the pairwise search
+        size_t mismatches = 0;
+        for (size_t i = 0; i < std::min<size_t>(matrix_size, 200); ++i) {
+            size_t j = (i * 7919) % matrix_size;
+            DistanceResult r = graph.distance_classic(sources[i], targets[j], ctx);
+            double expected = r.reachable ? r.distance : -1;
+            if (std::abs(matrix[i * matrix_size + j] - expected) > 1e-9 * std::max(1.0, expected)) ++mismatches;
+        }
+        std::cout << "matrix vs classic-distance: " << mismatches << " mismatches\n";
+        failures += mismatches;
+    }
+
+    if (cell_res >= 0) {
+        std::vector<uint32_t> sources;
+        for (size_t i = 0; i < std::min<size_t>(pairs.size(), 64); ++i) sources.push_back(pairs[i].first);
+        auto c0 = std::chrono::steady_clock::now();
+        CellGrouping cells = graph.cell_grouping(cell_res);
+        auto c1 = std::chrono::steady_clock::now();
+        std::vector<double> table = graph.one_to_all_cells_many(sources, cells, CellReduce::MIN_DISTANCE);
+        auto c2 = std::chrono::steady_clock::now();
+        size_t n = graph.indexed_edge_count(), width = cells.cells.size();
+        std::cout << "cells res " << cell_res << ": " << width << " cells, grouping "
+                  << std::chrono::duration<double, std::milli>(c1 - c0).count() << " ms, "
+                  << std::chrono::duration<double, std::milli>(c2 - c1).count() / std::max<size_t>(sources.size(), 1)
+                  << " ms per source, table " << table.size() * sizeof(double) / 1024 << " KB vs "
+                  << sources.size() * n * sizeof(double) / 1024 << " KB per edge\n";
+
+        // Per-cell minimum of the per-edge rows
+        size_t mismatches = 0;
+        for (size_t i = 0; i < std::min<size_t>(sources.size(), 8); ++i) {
+            std::vector<double> dist = graph.one_to_all(sources[i]);
+            std::vector<double> expected(width, -1);
+            for (size_t v = 0; v < n; ++v) {
+                uint32_t c = cells.slot[v];
+                if (c == CellGrouping::NO_CELL || dist[v] < 0) continue;
+                if (expected[c] < 0 || dist[v] < expected[c]) expected[c] = dist[v];
+            }
+            if (!std::equal(expected.begin(), expected.end(), table.begin() + i * width)) ++mismatches;
+        }
+        std::cout << "cells vs one-to-all: " << mismatches << " rows differ\n";
+        failures += mismatches;
+    }
+
+    return failures > 0 ? 1 : 0;
+}
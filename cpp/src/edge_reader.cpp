@@ -0,0 +1,286 @@
+/**
+ * @file edge_reader.cpp
+ * @brief Edge metadata readers: memory-mapped CSV and Parquet.
+ */
+
+#include "edge_reader.hpp"
+#include "parallel.hpp"
+#include "parquet_io.hpp"
+
+#include <arrow/api.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace edge_reader {
+
+void EdgeRecords::append(const EdgeRecords& other) {
+    id.insert(id.end(), other.id.begin(), other.id.end());
+    incoming_cell.insert(incoming_cell.end(), other.incoming_cell.begin(), other.incoming_cell.end());
+    outgoing_cell.insert(outgoing_cell.end(), other.outgoing_cell.begin(), other.outgoing_cell.end());
+    lca_res.insert(lca_res.end(), other.lca_res.begin(), other.lca_res.end());
+    length.insert(length.end(), other.length.begin(), other.length.end());
+    cost.insert(cost.end(), other.cost.begin(), other.cost.end());
+}
+
+namespace {
+
+// Read-only mapping of a whole file; an empty file maps to no bytes
+class MappedFile {
+public:
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            data_ = static_cast<const char*>(addr);
+            ::madvise(addr, size_, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        return true;
+    }
+
+    ~MappedFile() {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Columns: source, target, length, maxspeed, geometry, highway, cost, incoming_cell, outgoing_cell, lca_res, id
+// Indices:   0       1        2         3         4       5       6        7              8           9     10
+constexpr int COL_LENGTH = 2;
+constexpr int COL_COST = 6;
+constexpr int COL_INCOMING_CELL = 7;
+constexpr int COL_OUTGOING_CELL = 8;
+constexpr int COL_LCA_RES = 9;
+constexpr int COL_ID = 10;
+constexpr int NUM_COLUMNS = 11;
+
+constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+struct Field {
+    const char* begin;
+    const char* end;
+};
+
+// Parse a leading number, ignoring surrounding quotes and leading blanks.
+// Trailing characters (e.g. '\r') are ignored, as std::stoul/std::stod do.
+template <typename T>
+bool parse(Field f, T& out) {
+    const char* p = f.begin;
+    while (p < f.end && (*p == '"' || *p == ' ' || *p == '\t')) ++p;
+    auto [ptr, ec] = std::from_chars(p, f.end, out);
+    return ec == std::errc() && ptr != p;
+}
+
+// Split one line into its first NUM_COLUMNS fields. Commas inside quotes do
+// not separate fields; quoted spans (geometry) are skipped with memchr.
+// Returns the total number of fields on the line.
+int split(const char* p, const char* end, Field* fields) {
+    int count = 0;
+    const char* start = p;
+    while (p < end) {
+        if (*p == '"') {
+            const char* close = static_cast<const char*>(std::memchr(p + 1, '"', end - p - 1));
+            p = close ? close + 1 : end;
+        } else if (*p == ',') {
+            if (count < NUM_COLUMNS) fields[count] = {start, p};
+            ++count;
+            start = ++p;
+        } else {
+            ++p;
+        }
+    }
+    if (count < NUM_COLUMNS) fields[count] = {start, end};
+    return count + 1;
+}
+
+void parse_chunk(const char* p, const char* end, EdgeRecords& out) {
+    Field fields[NUM_COLUMNS];
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+
+        if (split(p, eol, fields) >= NUM_COLUMNS) {
+            uint32_t id;
+            uint64_t incoming_cell, outgoing_cell;
+            int32_t lca_res;
+            double length, cost;
+            if (parse(fields[COL_ID], id) && parse(fields[COL_INCOMING_CELL], incoming_cell) &&
+                parse(fields[COL_OUTGOING_CELL], outgoing_cell) && parse(fields[COL_LCA_RES], lca_res) &&
+                parse(fields[COL_LENGTH], length) && parse(fields[COL_COST], cost)) {
+                out.id.push_back(id);
+                out.incoming_cell.push_back(incoming_cell);
+                out.outgoing_cell.push_back(outgoing_cell);
+                out.lca_res.push_back(lca_res);
+                out.length.push_back(length);
+                out.cost.push_back(cost);
+            }
+            // Otherwise skip malformed row
+        }
+        p = eol + 1;
+    }
+}
+
+}  // namespace
+
+bool read_csv(const std::string& path, EdgeRecords& out) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    const char* data = file.data();
+    size_t size = file.size();
+
+    // Skip header
+    const char* first = data ? static_cast<const char*>(std::memchr(data, '\n', size)) : nullptr;
+    size_t body = first ? static_cast<size_t>(first - data) + 1 : size;
+
+    // Chunk boundaries are moved forward to the next line start, so every
+    // line belongs to exactly one chunk and chunks keep file order
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(4 * parallel::default_threads(),
+                                                         (size - body) / MIN_CHUNK_BYTES));
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t c = 0; c <= chunks; ++c) {
+        size_t pos = body + (size - body) * c / chunks;
+        if (pos > body && pos < size) {
+            const char* nl = static_cast<const char*>(std::memchr(data + pos - 1, '\n', size - pos + 1));
+            pos = nl ? static_cast<size_t>(nl - data) + 1 : size;
+        }
+        bounds[c] = pos;
+    }
+
+    std::vector<EdgeRecords> parts(chunks);
+    parallel::for_each_index(chunks, [&](size_t c) {
+        parse_chunk(data + bounds[c], data + bounds[c + 1], parts[c]);
+    });
+
+    out = EdgeRecords();
+    for (const EdgeRecords& part : parts) out.append(part);
+    return true;
+}
+
+namespace {
+
+const std::vector<const char*> PARQUET_COLUMNS = {
+    "id", "incoming_cell", "outgoing_cell", "lca_res", "length", "cost"};
+
+// Copy a numeric Arrow column into out, converting to T
+template <typename T>
+void column_values(const arrow::Array& array, std::vector<T>& out) {
+    auto copy = [&](const auto& typed) {
+        out.resize(static_cast<size_t>(typed.length()));
+        for (int64_t i = 0; i < typed.length(); ++i) out[i] = static_cast<T>(typed.Value(i));
+    };
+    switch (array.type_id()) {
+        case arrow::Type::INT8:   copy(static_cast<const arrow::Int8Array&>(array)); break;
+        case arrow::Type::INT16:  copy(static_cast<const arrow::Int16Array&>(array)); break;
+        case arrow::Type::INT32:  copy(static_cast<const arrow::Int32Array&>(array)); break;
+        case arrow::Type::INT64:  copy(static_cast<const arrow::Int64Array&>(array)); break;
+        case arrow::Type::UINT8:  copy(static_cast<const arrow::UInt8Array&>(array)); break;
+        case arrow::Type::UINT16: copy(static_cast<const arrow::UInt16Array&>(array)); break;
+        case arrow::Type::UINT32: copy(static_cast<const arrow::UInt32Array&>(array)); break;
+        case arrow::Type::UINT64: copy(static_cast<const arrow::UInt64Array&>(array)); break;
+        case arrow::Type::FLOAT:  copy(static_cast<const arrow::FloatArray&>(array)); break;
+        case arrow::Type::DOUBLE: copy(static_cast<const arrow::DoubleArray&>(array)); break;
+        default:
+            throw std::runtime_error("Unsupported type for edge column: " + array.type()->ToString());
+    }
+}
+
+// Decode a run of row groups batch by batch, appending non-null rows to out
+void read_run(parquet::arrow::FileReader& reader, const parquet_io::RowGroupRun& run, EdgeRecords& out) {
+    std::vector<int> groups(run.num_groups);
+    for (int g = 0; g < run.num_groups; ++g) groups[g] = run.first_group + g;
+
+    std::unique_ptr<arrow::RecordBatchReader> batches;
+    PARQUET_ASSIGN_OR_THROW(batches, reader.GetRecordBatchReader(groups, parquet_io::column_indices(reader, PARQUET_COLUMNS)));
+
+    EdgeRecords batch_rows;
+    for (;;) {
+        std::shared_ptr<arrow::RecordBatch> batch;
+        PARQUET_THROW_NOT_OK(batches->ReadNext(&batch));
+        if (!batch) break;
+
+        std::vector<std::shared_ptr<arrow::Array>> columns;
+        for (const char* name : PARQUET_COLUMNS) columns.push_back(batch->GetColumnByName(name));
+        column_values(*columns[0], batch_rows.id);
+        column_values(*columns[1], batch_rows.incoming_cell);
+        column_values(*columns[2], batch_rows.outgoing_cell);
+        column_values(*columns[3], batch_rows.lca_res);
+        column_values(*columns[4], batch_rows.length);
+        column_values(*columns[5], batch_rows.cost);
+
+        bool has_nulls = false;
+        for (const auto& column : columns) has_nulls |= column->null_count() > 0;
+        if (!has_nulls) {
+            out.append(batch_rows);
+            continue;
+        }
+
+        // Compact away rows with a null in any column
+        size_t kept = 0;
+        for (int64_t i = 0; i < batch->num_rows(); ++i) {
+            bool valid = true;
+            for (const auto& column : columns) valid &= column->IsValid(i);
+            if (!valid) continue;
+            batch_rows.id[kept] = batch_rows.id[i];
+            batch_rows.incoming_cell[kept] = batch_rows.incoming_cell[i];
+            batch_rows.outgoing_cell[kept] = batch_rows.outgoing_cell[i];
+            batch_rows.lca_res[kept] = batch_rows.lca_res[i];
+            batch_rows.length[kept] = batch_rows.length[i];
+            batch_rows.cost[kept] = batch_rows.cost[i];
+            ++kept;
+        }
+        batch_rows.id.resize(kept);
+        batch_rows.incoming_cell.resize(kept);
+        batch_rows.outgoing_cell.resize(kept);
+        batch_rows.lca_res.resize(kept);
+        batch_rows.length.resize(kept);
+        batch_rows.cost.resize(kept);
+        out.append(batch_rows);
+    }
+}
+
+}  // namespace
+
+bool read_parquet(const std::string& path, EdgeRecords& out) {
+    std::vector<std::string> files = parquet_io::list_files(path);
+    size_t total = 0;
+    std::vector<parquet_io::RowGroupRun> runs = parquet_io::plan_runs(files, total);
+
+    std::vector<EdgeRecords> parts(runs.size());
+    parallel::for_each_index(runs.size(), [&](size_t r) {
+        auto reader = parquet_io::open(files[runs[r].file]);
+        read_run(*reader, runs[r], parts[r]);
+    });
+
+    out = EdgeRecords();
+    for (const EdgeRecords& part : parts) out.append(part);
+    return !files.empty();
+}
+
+}  // namespace edge_reader
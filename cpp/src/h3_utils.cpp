@@ -1,12 +1,13 @@
 /**
  * @file h3_utils.cpp
- * @brief H3 utility functions implementation.
+ * @brief libh3-backed H3 operations, the reference for the bit versions.
  */
 
 #include "h3_utils.hpp"
 #include <h3/h3api.h>
 
 namespace h3_utils {
+namespace libh3 {
 
 int get_resolution(uint64_t cell) {
     if (cell == 0) return -1;
@@ -56,4 +57,12 @@ bool parent_check(uint64_t node_cell, uint64_t high_cell, int high_res) {
     return parent == high_cell;
 }
 
+uint64_t lat_lng_to_cell(double lat, double lng, int res) {
+    LatLng point{degsToRads(lat), degsToRads(lng)};
+    H3Index cell = 0;
+    if (latLngToCell(&point, res, &cell) != E_SUCCESS) return 0;
+    return cell;
+}
+
+}  // namespace libh3
 }  // namespace h3_utils
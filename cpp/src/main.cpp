@@ -12,7 +12,8 @@ void print_usage(const char* prog) {
     std::cerr << "Usage: " << prog << " [options]\n"
               << "Options:\n"
               << "  --shortcuts PATH   Path to shortcuts Parquet directory\n"
-              << "  --edges PATH       Path to edge metadata CSV\n"
+              << "  --edges PATH       Path to edge metadata CSV or Parquet\n"
+              << "  --snapshot PATH    Binary snapshot from routing_prepare (replaces --shortcuts/--edges)\n"
               << "  --source ID        Source edge ID\n"
               << "  --target ID        Target edge ID\n"
               << "  --algorithm ALG    Algorithm: classic, pruned (default: pruned)\n"
@@ -20,7 +21,7 @@ void print_usage(const char* prog) {
 }
 
 int main(int argc, char* argv[]) {
-    std::string shortcuts_path, edges_path;
+    std::string shortcuts_path, edges_path, snapshot_path;
     uint32_t source = 0, target = 0;
     std::string algorithm = "pruned";
     
@@ -29,6 +30,8 @@ int main(int argc, char* argv[]) {
             shortcuts_path = argv[++i];
         } else if (std::strcmp(argv[i], "--edges") == 0 && i + 1 < argc) {
             edges_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshot_path = argv[++i];
         } else if (std::strcmp(argv[i], "--source") == 0 && i + 1 < argc) {
             source = std::stoul(argv[++i]);
         } else if (std::strcmp(argv[i], "--target") == 0 && i + 1 < argc) {
@@ -41,30 +44,43 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    if (shortcuts_path.empty() || edges_path.empty()) {
-        std::cerr << "Error: --shortcuts and --edges are required\n";
+    if (snapshot_path.empty() && (shortcuts_path.empty() || edges_path.empty())) {
+        std::cerr << "Error: --snapshot or --shortcuts and --edges are required\n";
         print_usage(argv[0]);
         return 1;
     }
     
     ShortcutGraph graph;
     
-    std::cout << "Loading shortcuts from: " << shortcuts_path << "\n";
     auto t0 = std::chrono::steady_clock::now();
-    if (!graph.load_shortcuts(shortcuts_path)) {
-        std::cerr << "Error: Failed to load shortcuts\n";
-        return 1;
-    }
-    auto t1 = std::chrono::steady_clock::now();
-    auto load_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
-    std::cout << "Loaded " << graph.shortcut_count() << " shortcuts in " << load_ms << " ms\n";
-    
-    std::cout << "Loading edges from: " << edges_path << "\n";
-    if (!graph.load_edge_metadata(edges_path)) {
-        std::cerr << "Error: Failed to load edge metadata\n";
-        return 1;
+    auto t1 = t0;
+    if (!snapshot_path.empty()) {
+        std::cout << "Opening snapshot: " << snapshot_path << "\n";
+        if (!graph.load_snapshot(snapshot_path)) {
+            std::cerr << "Error: Failed to open snapshot\n";
+            return 1;
+        }
+        t1 = std::chrono::steady_clock::now();
+        auto load_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+        std::cout << "Opened " << graph.shortcut_count() << " shortcuts, " << graph.edge_count()
+                  << " edges in " << load_us / 1000.0 << " ms\n\n";
+    } else {
+        std::cout << "Loading shortcuts from: " << shortcuts_path << "\n";
+        if (!graph.load_shortcuts(shortcuts_path)) {
+            std::cerr << "Error: Failed to load shortcuts\n";
+            return 1;
+        }
+        t1 = std::chrono::steady_clock::now();
+        auto load_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+        std::cout << "Loaded " << graph.shortcut_count() << " shortcuts in " << load_ms << " ms\n";
+        
+        std::cout << "Loading edges from: " << edges_path << "\n";
+        if (!graph.load_edge_metadata(edges_path)) {
+            std::cerr << "Error: Failed to load edge metadata\n";
+            return 1;
+        }
+        std::cout << "Loaded " << graph.edge_count() << " edges\n\n";
     }
-    std::cout << "Loaded " << graph.edge_count() << " edges\n\n";
     
     if (source == 0 && target == 0) {
         std::cout << "No query specified. Use --source and --target.\n";
@@ -86,6 +102,7 @@ int main(int argc, char* argv[]) {
     
     if (result.reachable) {
         std::cout << "Distance: " << result.distance << "\n";
+        std::cout << "Length: " << result.length << " m\n";
         std::cout << "Path length: " << result.path.size() << " edges\n";
         std::cout << "Query time: " << query_us / 1000.0 << " ms\n";
         
@@ -0,0 +1,154 @@
+/**
+ * @file min_plus.cpp
+ * @brief Min-plus row kernels (scalar, AVX2, AVX-512) and tiled bucket joins.
+ */
+
+#include "min_plus.hpp"
+
+#include <algorithm>
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+namespace min_plus {
+
+namespace {
+
+void relax_scalar(double* row, const uint32_t* cols, const double* vals, size_t n, double d) {
+    for (size_t k = 0; k < n; ++k) {
+        double total = d + vals[k];
+        if (total < row[cols[k]]) row[cols[k]] = total;
+    }
+}
+
+#ifdef CPU_FEATURES_X86
+
+// Compiled for AVX2 only here; callers check best_kernel() first.
+// AVX2 has no scatter, so the four minima are stored lane by lane; storing
+// unconditionally avoids a data-dependent branch per lane.
+__attribute__((target("avx2"))) void relax_avx2(double* row, const uint32_t* cols, const double* vals,
+                                                size_t n, double d) {
+    const __m256d add = _mm256_set1_pd(d);
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cols + k));
+        __m256d old = _mm256_i32gather_pd(row, index, 8);
+        __m256d best = _mm256_min_pd(old, _mm256_add_pd(add, _mm256_loadu_pd(vals + k)));
+        __m128d low = _mm256_castpd256_pd128(best);
+        __m128d high = _mm256_extractf128_pd(best, 1);
+        _mm_storel_pd(row + cols[k], low);
+        _mm_storeh_pd(row + cols[k + 1], low);
+        _mm_storel_pd(row + cols[k + 2], high);
+        _mm_storeh_pd(row + cols[k + 3], high);
+    }
+    relax_scalar(row, cols + k, vals + k, n - k, d);
+}
+
+__attribute__((target("avx512f"))) void relax_avx512(double* row, const uint32_t* cols, const double* vals,
+                                                     size_t n, double d) {
+    const __m512d add = _mm512_set1_pd(d);
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cols + k));
+        __m512d old = _mm512_i32gather_pd(index, row, 8);
+        __m512d total = _mm512_add_pd(add, _mm512_loadu_pd(vals + k));
+        __mmask8 better = _mm512_cmp_pd_mask(total, old, _CMP_LT_OQ);
+        _mm512_mask_i32scatter_pd(row, better, index, total, 8);
+    }
+    relax_scalar(row, cols + k, vals + k, n - k, d);
+}
+
+#endif
+
+}  // namespace
+
+bool supported(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::AVX2: return cpu_features::supported(cpu_features::Isa::AVX2);
+        case Kernel::AVX512: return cpu_features::supported(cpu_features::Isa::AVX512);
+        default: return true;
+    }
+}
+
+Kernel best_kernel() {
+    static const Kernel detected = [] {
+        for (Kernel kernel : {Kernel::AVX2, Kernel::AVX512}) {
+            if (supported(kernel)) return kernel;
+        }
+        return Kernel::SCALAR;
+    }();
+    return detected;
+}
+
+const char* kernel_name(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::AVX2: return "avx2";
+        case Kernel::AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+void relax(Kernel kernel, double* row, const uint32_t* cols, const double* vals, size_t n, double d) {
+    switch (kernel) {
+#ifdef CPU_FEATURES_X86
+        case Kernel::AVX2: relax_avx2(row, cols, vals, n, d); break;
+        case Kernel::AVX512: relax_avx512(row, cols, vals, n, d); break;
+#endif
+        default: relax_scalar(row, cols, vals, n, d); break;
+    }
+}
+
+Buckets build_buckets(size_t node_count, std::vector<std::vector<std::pair<uint32_t, double>>>& settled) {
+    Buckets b;
+    b.offsets.assign(node_count + 1, 0);
+    for (const auto& list : settled) {
+        for (const auto& [u, d] : list) ++b.offsets[u + 1];
+    }
+    for (size_t u = 0; u < node_count; ++u) b.offsets[u + 1] += b.offsets[u];
+
+    // Filling columns in order keeps every bucket column-sorted
+    b.cols.resize(b.offsets[node_count]);
+    b.dists.resize(b.offsets[node_count]);
+    std::vector<size_t> fill(b.offsets.begin(), b.offsets.end() - 1);
+    for (size_t j = 0; j < settled.size(); ++j) {
+        for (const auto& [u, d] : settled[j]) {
+            b.cols[fill[u]] = static_cast<uint32_t>(j);
+            b.dists[fill[u]++] = d;
+        }
+        std::vector<std::pair<uint32_t, double>>().swap(settled[j]);
+    }
+    return b;
+}
+
+void join_row(const Buckets& buckets, const std::vector<std::pair<uint32_t, double>>& settled,
+              double* row, size_t num_cols, Kernel kernel) {
+    const uint32_t* cols = buckets.cols.data();
+    const double* dists = buckets.dists.data();
+
+    if (num_cols <= TILE_COLUMNS) {
+        for (const auto& [u, d] : settled) {
+            size_t first = buckets.offsets[u];
+            relax(kernel, row, cols + first, dists + first, buckets.offsets[u + 1] - first, d);
+        }
+        return;
+    }
+
+    // Per settled node, the start of its bucket's part in the current tile
+    std::vector<size_t> cursor(settled.size());
+    for (size_t s = 0; s < settled.size(); ++s) cursor[s] = buckets.offsets[settled[s].first];
+
+    for (size_t tile_end = TILE_COLUMNS;; tile_end += TILE_COLUMNS) {
+        bool last = tile_end >= num_cols;
+        for (size_t s = 0; s < settled.size(); ++s) {
+            size_t first = cursor[s];
+            size_t end = buckets.offsets[settled[s].first + 1];
+            if (!last) end = std::lower_bound(cols + first, cols + end, tile_end) - cols;
+            relax(kernel, row, cols + first, dists + first, end - first, settled[s].second);
+            cursor[s] = end;
+        }
+        if (last) break;
+    }
+}
+
+}  // namespace min_plus
@@ -0,0 +1,90 @@
+/**
+ * @file parquet_io.cpp
+ * @brief Shared helpers for parallel Parquet reading.
+ */
+
+#include "parquet_io.hpp"
+#include "parallel.hpp"
+
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <parquet/exception.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace parquet_io {
+
+std::unique_ptr<parquet::arrow::FileReader> open(const std::string& path) {
+    arrow::MemoryPool* pool = arrow::default_memory_pool();
+
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(path, pool));
+
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(infile, pool, &reader));
+    reader->set_use_threads(false);
+    return reader;
+}
+
+std::vector<std::string> list_files(const std::string& path) {
+    std::vector<std::string> files;
+    if (fs::is_directory(path)) {
+        // All .parquet files in name order, for a deterministic layout
+        for (const auto& entry : fs::directory_iterator(path)) {
+            if (entry.path().extension() == ".parquet") {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+    } else {
+        files.push_back(path);
+    }
+    return files;
+}
+
+std::vector<RowGroupRun> plan_runs(const std::vector<std::string>& files, size_t& total_rows) {
+    std::vector<std::vector<int64_t>> group_rows(files.size());
+    parallel::for_each_index(files.size(), [&](size_t f) {
+        auto reader = open(files[f]);
+        auto metadata = reader->parquet_reader()->metadata();
+        for (int g = 0; g < reader->num_row_groups(); ++g) {
+            group_rows[f].push_back(metadata->RowGroup(g)->num_rows());
+        }
+    });
+
+    // Each run opens its file once, so runs should not be too short
+    size_t total_groups = 0;
+    for (const auto& rows : group_rows) total_groups += rows.size();
+    size_t run = std::max<size_t>(1, total_groups / (4 * parallel::default_threads()));
+
+    std::vector<RowGroupRun> runs;
+    total_rows = 0;
+    for (size_t f = 0; f < files.size(); ++f) {
+        for (size_t g = 0; g < group_rows[f].size(); ++g) {
+            if (g % run == 0) {
+                int n = static_cast<int>(std::min(run, group_rows[f].size() - g));
+                runs.push_back({f, static_cast<int>(g), n, total_rows, 0});
+            }
+            runs.back().num_rows += static_cast<size_t>(group_rows[f][g]);
+            total_rows += static_cast<size_t>(group_rows[f][g]);
+        }
+    }
+    return runs;
+}
+
+std::vector<int> column_indices(parquet::arrow::FileReader& reader, const std::vector<const char*>& names) {
+    const parquet::SchemaDescriptor* schema = reader.parquet_reader()->metadata()->schema();
+    std::vector<int> columns;
+    for (const char* name : names) {
+        int index = schema->ColumnIndex(name);
+        if (index < 0) throw std::runtime_error(std::string("Parquet file has no column ") + name);
+        columns.push_back(index);
+    }
+    return columns;
+}
+
+}  // namespace parquet_io
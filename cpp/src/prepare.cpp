@@ -0,0 +1,79 @@
+/**
+ * @file prepare.cpp
+ * @brief Builds a binary graph snapshot from Parquet shortcuts and edge metadata.
+ */
+
+#include "shortcut_graph.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "Options:\n"
+              << "  --shortcuts PATH   Path to shortcuts Parquet directory\n"
+              << "  --edges PATH       Path to edge metadata CSV or Parquet\n"
+              << "  --output PATH      Snapshot file to write\n"
+              << "  --verify           Reopen the snapshot and check all checksums\n"
+              << "  --help             Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string shortcuts_path, edges_path, output_path;
+    bool verify = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--shortcuts") == 0 && i + 1 < argc) {
+            shortcuts_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--edges") == 0 && i + 1 < argc) {
+            edges_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        } else if (std::strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+
+    if (shortcuts_path.empty() || edges_path.empty() || output_path.empty()) {
+        std::cerr << "Error: --shortcuts, --edges and --output are required\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    ShortcutGraph graph;
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (!graph.load_shortcuts(shortcuts_path)) {
+        std::cerr << "Error: Failed to load shortcuts\n";
+        return 1;
+    }
+    if (!graph.load_edge_metadata(edges_path)) {
+        std::cerr << "Error: Failed to load edge metadata\n";
+        return 1;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "Loaded " << graph.shortcut_count() << " shortcuts, " << graph.edge_count() << " edges in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms\n";
+
+    if (!graph.save_snapshot(output_path)) {
+        std::cerr << "Error: Failed to write snapshot " << output_path << "\n";
+        return 1;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    std::cout << "Wrote " << output_path << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << " ms\n";
+
+    if (verify) {
+        ShortcutGraph check;
+        if (!check.load_snapshot(output_path, true)) {
+            std::cerr << "Error: Snapshot verification failed\n";
+            return 1;
+        }
+        std::cout << "Verified " << check.shortcut_count() << " shortcuts, " << check.edge_count() << " edges\n";
+    }
+
+    return 0;
+}
@@ -4,449 +4,1173 @@
  */
 
 #include "shortcut_graph.hpp"
+#include "cpu_features.hpp"
+#include "edge_reader.hpp"
 #include "h3_utils.hpp"
+#include "min_plus.hpp"
+#include "parallel.hpp"
+#include "parquet_io.hpp"
+#include "snapshot.hpp"
 
 #include <arrow/api.h>
-#include <arrow/io/api.h>
 #include <parquet/arrow/reader.h>
 
-#include <fstream>
-#include <queue>
-#include <sstream>
+#include <cmath>
 #include <limits>
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <iterator>
+#include <stdexcept>
 
 namespace fs = std::filesystem;
 
-// Priority queue entry
-struct PQEntry {
-    double dist;
-    uint32_t edge;
-    bool operator>(const PQEntry& o) const { return dist > o.dist; }
-};
+// Label write of the search kernels; distance-only searches leave the parent untouched
+template <bool TrackParents>
+static void set_label(SearchSpace& space, uint32_t v, double dist, uint32_t parent) {
+    if constexpr (TrackParents) {
+        space.set(v, dist, parent);
+    } else {
+        space.set_dist(v, dist);
+    }
+}
+
+static QueryContext& thread_context() {
+    thread_local QueryContext ctx;
+    return ctx;
+}
+
+// Run task(i, ctx) for i in [0, count) on up to threads workers, each with
+// its own context; workers pull indices from a shared counter
+template <typename Task>
+static void for_each_with_context(size_t count, unsigned threads, Task&& task) {
+    std::atomic<size_t> next{0};
+    parallel::for_each_index(std::min<size_t>(threads, count), [&](size_t) {
+        QueryContext ctx;
+        for (;;) {
+            size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) return;
+            task(i, ctx);
+        }
+    }, threads);
+}
+
+#ifdef CPU_FEATURES_X86
+#define LANES_INLINE __attribute__((always_inline)) inline
+#else
+#define LANES_INLINE inline
+#endif
+
+// One sweep position: pull K lanes (labels[p * K ..]) over the position's
+// arcs, true if any lane improved. The fixed-width lane loops vectorize in
+// whatever ISA the caller is compiled for
+template <unsigned K>
+LANES_INLINE bool pull_lanes(double* labels, uint32_t p, const Arc* first, const Arc* last) {
+    double* label = labels + size_t(p) * K;
+    double best[K];
+    for (unsigned k = 0; k < K; ++k) best[k] = label[k];
+    for (const Arc* a = first; a != last; ++a) {
+        const double* from = labels + size_t(a->target) * K;
+        double cost = a->cost;
+        for (unsigned k = 0; k < K; ++k) {
+            double nd = from[k] + cost;
+            best[k] = nd < best[k] ? nd : best[k];
+        }
+    }
+    bool changed = false;
+    for (unsigned k = 0; k < K; ++k) {
+        changed |= best[k] < label[k];
+        label[k] = best[k];
+    }
+    return changed;
+}
+
+// Downward sweep over K-lane labels: each position pulls over its down and
+// lateral arcs, whose tails come earlier in the order or lie in the same
+// cyclic group
+template <unsigned K>
+LANES_INLINE void sweep_lanes_core(const CsrGraph& sweep, const MappedVector<uint32_t>& cyclic, double* labels) {
+    uint32_t n = static_cast<uint32_t>(sweep.node_count());
+    size_t next_cyclic = 0;
+    for (uint32_t p = 0; p < n;) {
+        if (next_cyclic < cyclic.size() && cyclic[next_cyclic] == p) {
+            // Label-correcting passes; nonnegative costs settle within group-size passes
+            uint32_t end = cyclic[next_cyclic + 1];
+            for (bool changed = true; changed;) {
+                changed = false;
+                for (uint32_t q = p; q < end; ++q) changed |= pull_lanes<K>(labels, q, sweep.begin(q), sweep.end(q));
+            }
+            p = end;
+            next_cyclic += 2;
+        } else {
+            pull_lanes<K>(labels, p, sweep.begin(p), sweep.end(p));
+            ++p;
+        }
+    }
+}
+
+template <unsigned K>
+static void sweep_lanes_generic(const CsrGraph& sweep, const MappedVector<uint32_t>& cyclic, double* labels) {
+    sweep_lanes_core<K>(sweep, cyclic, labels);
+}
+
+#ifdef CPU_FEATURES_X86
+template <unsigned K>
+__attribute__((target("avx2"))) static void sweep_lanes_avx2(const CsrGraph& sweep, const MappedVector<uint32_t>& cyclic,
+                                                             double* labels) {
+    sweep_lanes_core<K>(sweep, cyclic, labels);
+}
+
+template <unsigned K>
+__attribute__((target("avx512f"))) static void sweep_lanes_avx512(const CsrGraph& sweep,
+                                                                  const MappedVector<uint32_t>& cyclic, double* labels) {
+    sweep_lanes_core<K>(sweep, cyclic, labels);
+}
+#endif
+
+// Widest vector ISA the CPU runs; unlike the bucket join the lane sweep
+// needs no scatter, so AVX-512 comes first
+static cpu_features::Isa lane_isa() {
+    static const cpu_features::Isa detected = [] {
+        for (cpu_features::Isa isa : {cpu_features::Isa::AVX512, cpu_features::Isa::AVX2}) {
+            if (cpu_features::supported(isa)) return isa;
+        }
+        return cpu_features::Isa::SCALAR;
+    }();
+    return detected;
+}
 
-using MinHeap = std::priority_queue<PQEntry, std::vector<PQEntry>, std::greater<PQEntry>>;
-
-// Helper to load a single parquet file
-static bool load_parquet_file(const std::string& filepath, 
-                              std::vector<Shortcut>& shortcuts,
-                              std::unordered_map<uint32_t, std::vector<size_t>>& fwd_adj,
-                              std::unordered_map<uint32_t, std::vector<size_t>>& bwd_adj) {
-    arrow::MemoryPool* pool = arrow::default_memory_pool();
-    
-    std::shared_ptr<arrow::io::ReadableFile> infile;
-    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(filepath, pool));
-    
-    std::unique_ptr<parquet::arrow::FileReader> reader;
-    PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(infile, pool, &reader));
-    
-    std::shared_ptr<arrow::Table> table;
-    PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
-    
-    // Handle chunked columns
-    auto incoming_chunked = table->GetColumnByName("incoming_edge");
-    auto outgoing_chunked = table->GetColumnByName("outgoing_edge");
-    auto cost_chunked = table->GetColumnByName("cost");
-    auto via_chunked = table->GetColumnByName("via_edge");
-    auto cell_chunked = table->GetColumnByName("cell");
-    auto inside_chunked = table->GetColumnByName("inside");
-    
-    for (int chunk = 0; chunk < incoming_chunked->num_chunks(); ++chunk) {
-        auto incoming = std::static_pointer_cast<arrow::Int64Array>(incoming_chunked->chunk(chunk));
-        auto outgoing = std::static_pointer_cast<arrow::Int64Array>(outgoing_chunked->chunk(chunk));
-        auto cost_col = std::static_pointer_cast<arrow::DoubleArray>(cost_chunked->chunk(chunk));
-        auto via_col = std::static_pointer_cast<arrow::Int64Array>(via_chunked->chunk(chunk));
-        auto cell_col = std::static_pointer_cast<arrow::Int64Array>(cell_chunked->chunk(chunk));
-        auto inside_col = std::static_pointer_cast<arrow::Int8Array>(inside_chunked->chunk(chunk));
+template <unsigned K>
+static void sweep_lanes(const CsrGraph& sweep, const MappedVector<uint32_t>& cyclic, double* labels) {
+#ifdef CPU_FEATURES_X86
+    switch (lane_isa()) {
+        case cpu_features::Isa::AVX512: sweep_lanes_avx512<K>(sweep, cyclic, labels); return;
+        case cpu_features::Isa::AVX2: sweep_lanes_avx2<K>(sweep, cyclic, labels); return;
+        default: break;
+    }
+#endif
+    sweep_lanes_generic<K>(sweep, cyclic, labels);
+}
+
+static const std::vector<const char*> SHORTCUT_COLUMNS = {
+    "incoming_edge", "outgoing_edge", "cost", "via_edge", "cell", "inside"};
+
+// Stream a run of row groups batch by batch into out[0 .. rows), so only one
+// batch of the projected columns is decoded at a time
+static void load_row_groups(parquet::arrow::FileReader& reader, const parquet_io::RowGroupRun& run, Shortcut* out) {
+    std::vector<int> groups(run.num_groups);
+    for (int g = 0; g < run.num_groups; ++g) groups[g] = run.first_group + g;
+    
+    std::unique_ptr<arrow::RecordBatchReader> batches;
+    PARQUET_ASSIGN_OR_THROW(batches, reader.GetRecordBatchReader(groups, parquet_io::column_indices(reader, SHORTCUT_COLUMNS)));
+    
+    size_t row = 0;
+    for (;;) {
+        std::shared_ptr<arrow::RecordBatch> batch;
+        PARQUET_THROW_NOT_OK(batches->ReadNext(&batch));
+        if (!batch) break;
+        if (row + static_cast<size_t>(batch->num_rows()) > run.num_rows) break;
+        
+        auto incoming = std::static_pointer_cast<arrow::Int64Array>(batch->GetColumnByName("incoming_edge"));
+        auto outgoing = std::static_pointer_cast<arrow::Int64Array>(batch->GetColumnByName("outgoing_edge"));
+        auto cost_col = std::static_pointer_cast<arrow::DoubleArray>(batch->GetColumnByName("cost"));
+        auto via_col = std::static_pointer_cast<arrow::Int64Array>(batch->GetColumnByName("via_edge"));
+        auto cell_col = std::static_pointer_cast<arrow::Int64Array>(batch->GetColumnByName("cell"));
+        auto inside_col = std::static_pointer_cast<arrow::Int8Array>(batch->GetColumnByName("inside"));
         
-        for (int64_t i = 0; i < incoming->length(); ++i) {
-            Shortcut sc;
+        for (int64_t i = 0; i < batch->num_rows(); ++i) {
+            Shortcut& sc = out[row++];
             sc.from = static_cast<uint32_t>(incoming->Value(i));
             sc.to = static_cast<uint32_t>(outgoing->Value(i));
             sc.cost = cost_col->Value(i);
             sc.via_edge = static_cast<uint32_t>(via_col->Value(i));
             sc.cell = static_cast<uint64_t>(cell_col->Value(i));
             sc.inside = inside_col->Value(i);
-            
-            size_t idx = shortcuts.size();
-            shortcuts.push_back(sc);
-            fwd_adj[sc.from].push_back(idx);
-            bwd_adj[sc.to].push_back(idx);
         }
     }
+    if (row != run.num_rows) {
+        throw std::runtime_error("Parquet row group size differs from footer metadata");
+    }
+}
+
+// Read all files in parallel into a pre-sized array, splitting large files by row group.
+// Rows keep (file name, row group, row) order regardless of scheduling.
+static void load_parquet_files(const std::vector<std::string>& files, std::vector<Shortcut>& shortcuts) {
+    size_t total = 0;
+    std::vector<parquet_io::RowGroupRun> runs = parquet_io::plan_runs(files, total);
     
-    return true;
+    shortcuts.resize(total);
+    parallel::for_each_index(runs.size(), [&](size_t r) {
+        auto reader = parquet_io::open(files[runs[r].file]);
+        load_row_groups(*reader, runs[r], shortcuts.data() + runs[r].first_row);
+    });
+}
+
+// Sorted union of two sorted, duplicate-free ID lists
+template <typename A, typename B>
+static std::vector<uint32_t> merge_ids(const A& a, const B& b) {
+    std::vector<uint32_t> out;
+    out.reserve(a.size() + b.size());
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+    return out;
+}
+
+static void sort_unique(std::vector<uint32_t>& ids) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
 }
 
 bool ShortcutGraph::load_shortcuts(const std::string& path) {
-    shortcuts_.clear();
-    fwd_adj_.clear();
-    bwd_adj_.clear();
-    
-    if (fs::is_directory(path)) {
-        // Load all .parquet files in directory
-        for (const auto& entry : fs::directory_iterator(path)) {
-            if (entry.path().extension() == ".parquet") {
-                load_parquet_file(entry.path().string(), shortcuts_, fwd_adj_, bwd_adj_);
+    std::vector<std::string> files = parquet_io::list_files(path);
+    
+    // Staging buffer; released once the CSR arrays are built
+    std::vector<Shortcut> shortcuts;
+    load_parquet_files(files, shortcuts);
+    
+    // Index = shortcut endpoints plus edges that already carry metadata
+    std::vector<uint32_t> ids;
+    ids.reserve(2 * shortcuts.size());
+    for (const Shortcut& sc : shortcuts) {
+        ids.push_back(sc.from);
+        ids.push_back(sc.to);
+    }
+    sort_unique(ids);
+    
+    std::vector<uint32_t> meta_ids;
+    for (size_t i = 0; i < edge_ids_.size(); ++i) {
+        if (meta_.present[i]) meta_ids.push_back(edge_ids_[i]);
+    }
+    
+    fwd_ = {};
+    bwd_ = {};
+    reindex(merge_ids(ids, meta_ids));
+    std::vector<uint32_t>().swap(ids);
+    build_csr(shortcuts);
+    build_sweep();
+    aggregate_lengths();
+    quantize_costs();
+    shortcut_count_ = shortcuts.size();
+    return shortcut_count_ > 0;
+}
+
+// Move column values to their new index; unmapped slots get fill
+template <typename T>
+static void remap_column(MappedVector<T>& col, const std::vector<uint32_t>& remap, size_t n, T fill) {
+    std::vector<T> out(n, fill);
+    for (size_t i = 0; i < remap.size() && i < col.size(); ++i) {
+        if (remap[i] != UINT32_MAX) out[remap[i]] = col[i];
+    }
+    col = std::move(out);
+}
+
+void ShortcutGraph::reindex(std::vector<uint32_t> edge_ids) {
+    // Old indices map monotonically into the new sorted superset, so arc order is preserved
+    size_t n = edge_ids.size();
+    std::vector<uint32_t> remap(edge_ids_.size(), NO_INDEX);
+    for (size_t i = 0, j = 0; i < edge_ids_.size(); ++i) {
+        while (j < n && edge_ids[j] < edge_ids_[i]) ++j;
+        if (j < n && edge_ids[j] == edge_ids_[i]) remap[i] = static_cast<uint32_t>(j);
+    }
+    
+    for (CsrGraph* csr : {&fwd_, &bwd_}) {
+        if (csr->offsets.empty()) continue;
+        uint32_t k = csr->parts;
+        std::vector<uint32_t> offsets(n * k + 1, 0);
+        for (size_t i = 0; i < remap.size(); ++i) {
+            for (uint32_t p = 0; p < k; ++p) {
+                offsets[remap[i] * k + p + 1] = csr->offsets[i * k + p + 1] - csr->offsets[i * k + p];
             }
         }
-    } else {
-        // Load single file
-        load_parquet_file(path, shortcuts_, fwd_adj_, bwd_adj_);
+        for (size_t i = 0; i < n * k; ++i) offsets[i + 1] += offsets[i];
+        csr->offsets = std::move(offsets);
+        
+        std::vector<Arc> arcs = csr->arcs.take();
+        for (Arc& a : arcs) a.target = remap[a.target];
+        csr->arcs = std::move(arcs);
     }
     
-    return !shortcuts_.empty();
+    const EdgeMeta blank;
+    remap_column(meta_.incoming_cell, remap, n, blank.incoming_cell);
+    remap_column(meta_.outgoing_cell, remap, n, blank.outgoing_cell);
+    remap_column<int32_t>(meta_.lca_res, remap, n, blank.lca_res);
+    remap_column(meta_.length, remap, n, blank.length);
+    remap_column(meta_.cost, remap, n, blank.cost);
+    remap_column<uint8_t>(meta_.present, remap, n, 0);
+    remap_column(meta_.lca_cell, remap, n, blank.incoming_cell);
+    edge_ids_ = std::move(edge_ids);
 }
 
-bool ShortcutGraph::load_edge_metadata(const std::string& path) {
-    std::ifstream file(path);
-    if (!file.is_open()) return false;
-    
-    std::string line;
-    std::getline(file, line);  // Skip header
-    
-    edge_meta_.clear();
-    while (std::getline(file, line)) {
-        // Parse CSV with quote handling
-        std::vector<std::string> row;
-        std::string field;
-        bool in_quotes = false;
+void ShortcutGraph::build_csr(std::vector<Shortcut>& shortcuts) {
+    constexpr uint32_t SKIP = UINT32_MAX;
+    size_t n = edge_ids_.size();
+    
+    // Endpoints become dense indices in place, so no per-arc side arrays are needed
+    for (Shortcut& sc : shortcuts) {
+        sc.from = index_of(sc.from);
+        sc.to = index_of(sc.to);
+    }
+    
+    // Bucket key = node * parts + part, or SKIP for arcs no search direction uses
+    auto fwd_key = [](const Shortcut& sc) { return (sc.inside == 1) ? sc.from : SKIP; };
+    auto bwd_key = [](const Shortcut& sc) {
+        switch (sc.inside) {
+            case -1: return sc.to * BWD_PARTS + BWD_DOWN;
+            case 0:  return sc.to * BWD_PARTS + BWD_LATERAL;
+            case -2: return sc.to * BWD_PARTS + BWD_OUTER;
+            default: return SKIP;
+        }
+    };
+    
+    // Counting sort by bucket; stable, so arc order within a bucket matches input order
+    auto fill = [&](CsrGraph& csr, uint32_t parts, auto key, auto target) {
+        size_t buckets = n * parts;
+        std::vector<uint32_t> offsets(buckets + 1, 0);
+        for (const Shortcut& sc : shortcuts) {
+            uint32_t k = key(sc);
+            if (k != SKIP) ++offsets[k + 1];
+        }
+        for (size_t i = 0; i < buckets; ++i) offsets[i + 1] += offsets[i];
         
-        for (char c : line) {
-            if (c == '"') {
-                in_quotes = !in_quotes;
-            } else if (c == ',' && !in_quotes) {
-                row.push_back(field);
-                field.clear();
+        std::vector<Arc> arcs(offsets[buckets]);
+        std::vector<uint32_t> via_edge(arcs.size());
+        std::vector<uint64_t> cell(arcs.size());
+        std::vector<uint32_t> pos(offsets.begin(), offsets.end() - 1);
+        for (const Shortcut& sc : shortcuts) {
+            uint32_t k = key(sc);
+            if (k == SKIP) continue;
+            uint32_t slot = pos[k]++;
+            arcs[slot] = {target(sc), static_cast<float>(sc.cost)};
+            via_edge[slot] = sc.via_edge;
+            cell[slot] = sc.cell;
+        }
+        
+        csr.parts = parts;
+        csr.offsets = std::move(offsets);
+        csr.arcs = std::move(arcs);
+        csr.via_edge = std::move(via_edge);
+        csr.cell = std::move(cell);
+    };
+    
+    fill(fwd_, 1, fwd_key, [](const Shortcut& sc) { return sc.to; });
+    fill(bwd_, BWD_PARTS, bwd_key, [](const Shortcut& sc) { return sc.from; });
+    build_shortcut_index();
+}
+
+static uint64_t next_layout_id() {
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+// (from, to) edge ID key of every arc, by global arc slot (fwd arcs, then bwd)
+std::vector<uint64_t> ShortcutGraph::arc_keys() const {
+    size_t n = edge_ids_.size();
+    std::vector<uint64_t> keys;
+    keys.reserve(fwd_.arcs.size() + bwd_.arcs.size());
+    if (fwd_.offsets.empty() || bwd_.offsets.empty()) return keys;  // metadata loaded before shortcuts
+    for (uint32_t u = 0; u < n; ++u) {
+        for (const Arc* a = fwd_.begin(u); a != fwd_.end(u); ++a) {
+            keys.push_back(ShortcutIndex::make_key(edge_ids_[u], edge_ids_[a->target]));
+        }
+    }
+    for (uint32_t v = 0; v < n; ++v) {
+        for (const Arc* a = bwd_.begin(v); a != bwd_.end(v, BWD_PARTS - 1); ++a) {
+            keys.push_back(ShortcutIndex::make_key(edge_ids_[a->target], edge_ids_[v]));
+        }
+    }
+    return keys;
+}
+
+void ShortcutGraph::build_shortcut_index() {
+    std::vector<float> costs;
+    costs.reserve(fwd_.arcs.size() + bwd_.arcs.size());
+    for (const CsrGraph* csr : {&fwd_, &bwd_}) {
+        for (const Arc& a : csr->arcs) costs.push_back(a.cost);
+    }
+    shortcut_index_.build(arc_keys(), costs);
+    layout_id_ = next_layout_id();
+}
+
+void ShortcutGraph::aggregate_lengths() {
+    size_t fwd_arcs = fwd_.arcs.size();
+    if (meta_count_ == 0) {
+        // No lengths yet; load_edge_metadata runs this again
+        fwd_.length = std::vector<double>(fwd_arcs, 0.0);
+        bwd_.length = std::vector<double>(bwd_.arcs.size(), 0.0);
+        return;
+    }
+    
+    // A hop without a via edge covers only its from edge; otherwise it is the
+    // sum of its two halves, and a half without a shortcut is a base edge.
+    // Lengths are full expansions, with the expansion height next to them:
+    // unpack_path stops at MAX_UNPACK_DEPTH, so an arc deeper than that (or
+    // on a via cycle in bad data) gets NaN and path_length unpacks it instead
+    constexpr uint32_t TOO_DEEP = MAX_UNPACK_DEPTH + 1;
+    std::vector<uint64_t> keys = arc_keys();
+    std::vector<double> length(keys.size(), 0.0);
+    std::vector<uint32_t> height(keys.size(), 0);
+    std::vector<uint8_t> state(keys.size(), 0);  // 0 new, 1 being expanded, 2 done
+    
+    auto via_of_arc = [&](uint32_t arc) {
+        uint32_t from = static_cast<uint32_t>(keys[arc] >> 32);
+        uint32_t to = static_cast<uint32_t>(keys[arc]);
+        uint32_t via = arc < fwd_arcs ? fwd_.via_edge[arc] : bwd_.via_edge[arc - fwd_arcs];
+        return (via == from || via == to) ? 0 : via;
+    };
+    
+    // Post-order over the via structure with an explicit stack, since a
+    // full expansion can be deeper than the unpack limit. A frame keeps the
+    // arcs of its two halves (NONE for a base edge) between its two visits
+    struct Frame {
+        uint32_t arc;
+        uint32_t half[2];
+    };
+    std::vector<Frame> stack;
+    for (uint32_t root = 0; root < keys.size(); ++root) {
+        if (state[root] != 0) continue;
+        stack.push_back({root, {ShortcutIndex::NONE, ShortcutIndex::NONE}});
+        while (!stack.empty()) {
+            Frame& top = stack.back();
+            uint32_t arc = top.arc;
+            uint32_t from = static_cast<uint32_t>(keys[arc] >> 32);
+            uint32_t via = via_of_arc(arc);
+            if (state[arc] == 0) {
+                state[arc] = 1;
+                if (via == 0) continue;
+                top.half[0] = shortcut_index_.find(from, via);
+                top.half[1] = shortcut_index_.find(via, static_cast<uint32_t>(keys[arc]));
+                Frame frame = top;
+                for (uint32_t half : frame.half) {
+                    if (half != ShortcutIndex::NONE && state[half] == 0) {
+                        stack.push_back({half, {ShortcutIndex::NONE, ShortcutIndex::NONE}});
+                    }
+                }
+                continue;
+            }
+            Frame frame = top;
+            stack.pop_back();
+            if (state[arc] == 2) continue;  // pushed by two parents
+            
+            if (via == 0) {
+                length[arc] = get_edge_length(from);
             } else {
-                field += c;
+                uint32_t deepest = 0;
+                for (int h = 0; h < 2; ++h) {
+                    uint32_t half = frame.half[h];
+                    if (half == ShortcutIndex::NONE) {
+                        length[arc] += get_edge_length(h == 0 ? from : via);
+                    } else {
+                        // A half still being expanded is an ancestor: a via cycle
+                        length[arc] += length[half];
+                        deepest = std::max(deepest, state[half] == 2 ? height[half] : TOO_DEEP);
+                    }
+                }
+                height[arc] = std::min(deepest + 1, TOO_DEEP);
             }
+            state[arc] = 2;
         }
-        row.push_back(field);  // Last field
+    }
+    for (uint32_t arc = 0; arc < keys.size(); ++arc) {
+        if (height[arc] > MAX_UNPACK_DEPTH) length[arc] = std::numeric_limits<double>::quiet_NaN();
+    }
+    
+    fwd_.length = std::vector<double>(length.begin(), length.begin() + fwd_arcs);
+    bwd_.length = std::vector<double>(length.begin() + fwd_arcs, length.end());
+}
+
+void ShortcutGraph::build_sweep() {
+    constexpr uint32_t UNVISITED = UINT32_MAX;
+    uint32_t n = static_cast<uint32_t>(edge_ids_.size());
+    auto arcs_begin = [&](uint32_t v) { return bwd_.offsets.empty() ? nullptr : bwd_.begin(v, BWD_DOWN); };
+    auto arcs_end = [&](uint32_t v) { return bwd_.offsets.empty() ? nullptr : bwd_.end(v, BWD_LATERAL); };
+    
+    // Iterative Tarjan over down and lateral arcs followed from head to tail.
+    // A component is emitted after every component that has arcs into it, so
+    // the emission order is a topological order of the sweep.
+    std::vector<uint32_t> order, cyclic;
+    std::vector<uint32_t> index(n, UNVISITED), low(n);
+    std::vector<uint8_t> on_stack(n, 0);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, const Arc*>> calls;
+    order.reserve(n);
+    uint32_t counter = 0;
+    
+    for (uint32_t root = 0; root < n; ++root) {
+        if (index[root] != UNVISITED) continue;
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        on_stack[root] = 1;
+        calls.push_back({root, arcs_begin(root)});
         
-        // Columns: source, target, length, maxspeed, geometry, highway, cost, incoming_cell, outgoing_cell, lca_res, id
-        // Indices:   0       1        2         3         4       5       6        7              8           9     10
-        if (row.size() >= 11) {
-            try {
-                uint32_t id = std::stoul(row[10]);
-                EdgeMeta meta;
-                meta.incoming_cell = std::stoull(row[7]);
-                meta.outgoing_cell = std::stoull(row[8]);
-                meta.lca_res = std::stoi(row[9]);
-                meta.length = std::stod(row[2]);
-                meta.cost = std::stod(row[6]);
-                edge_meta_[id] = meta;
-            } catch (...) {
-                // Skip malformed rows
+        while (!calls.empty()) {
+            auto& [v, next] = calls.back();
+            if (next != arcs_end(v)) {
+                uint32_t w = (next++)->target;
+                if (index[w] == UNVISITED) {
+                    index[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    on_stack[w] = 1;
+                    calls.push_back({w, arcs_begin(w)});
+                } else if (on_stack[w]) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
             }
+            
+            uint32_t done = v;
+            calls.pop_back();
+            if (!calls.empty()) low[calls.back().first] = std::min(low[calls.back().first], low[done]);
+            if (low[done] != index[done]) continue;
+            
+            uint32_t begin = static_cast<uint32_t>(order.size());
+            uint32_t w;
+            do {
+                w = stack.back();
+                stack.pop_back();
+                on_stack[w] = 0;
+                order.push_back(w);
+            } while (w != done);
+            if (order.size() - begin > 1) {
+                cyclic.push_back(begin);
+                cyclic.push_back(static_cast<uint32_t>(order.size()));
+            }
+        }
+    }
+    
+    std::vector<uint32_t> position(n);
+    for (uint32_t p = 0; p < n; ++p) position[order[p]] = p;
+    
+    // Arcs pulled by each position, in position order, so the sweep streams them
+    std::vector<uint32_t> offsets(n + 1, 0);
+    std::vector<Arc> arcs;
+    for (uint32_t p = 0; p < n; ++p) {
+        for (const Arc* a = arcs_begin(order[p]); a != arcs_end(order[p]); ++a) {
+            arcs.push_back({position[a->target], a->cost});
         }
+        offsets[p + 1] = static_cast<uint32_t>(arcs.size());
     }
     
-    return !edge_meta_.empty();
+    sweep_ = {};
+    sweep_.offsets = std::move(offsets);
+    sweep_.arcs = std::move(arcs);
+    sweep_order_ = std::move(order);
+    sweep_position_ = std::move(position);
+    sweep_cyclic_ = std::move(cyclic);
 }
 
-double ShortcutGraph::get_edge_cost(uint32_t edge_id) const {
-    auto it = edge_meta_.find(edge_id);
-    return (it != edge_meta_.end()) ? it->second.cost : 0.0;
+uint32_t ShortcutGraph::index_of(uint32_t edge_id) const {
+    auto it = std::lower_bound(edge_ids_.begin(), edge_ids_.end(), edge_id);
+    return (it != edge_ids_.end() && *it == edge_id) ? static_cast<uint32_t>(it - edge_ids_.begin()) : NO_INDEX;
 }
 
-uint64_t ShortcutGraph::get_edge_cell(uint32_t edge_id) const {
-    auto it = edge_meta_.find(edge_id);
-    return (it != edge_meta_.end()) ? it->second.incoming_cell : 0;
+bool ShortcutGraph::load_edge_metadata(const std::string& path) {
+    // Parquet for directories and .parquet files, CSV otherwise
+    bool parquet = fs::is_directory(path) || fs::path(path).extension() == ".parquet";
+    edge_reader::EdgeRecords rows;
+    if (!(parquet ? edge_reader::read_parquet(path, rows) : edge_reader::read_csv(path, rows))) return false;
+    
+    // One sort of (id, row) keys gives the sorted IDs and, as the last key of
+    // each ID, the row that wins on duplicates
+    std::vector<uint64_t> keys(rows.size());
+    for (size_t r = 0; r < rows.size(); ++r) keys[r] = (uint64_t(rows.id[r]) << 32) | r;
+    std::sort(keys.begin(), keys.end());
+    
+    std::vector<uint32_t> ids, winner;
+    for (size_t k = 0; k < keys.size(); ++k) {
+        if (k + 1 == keys.size() || (keys[k + 1] >> 32) != (keys[k] >> 32)) {
+            ids.push_back(static_cast<uint32_t>(keys[k] >> 32));
+            winner.push_back(static_cast<uint32_t>(keys[k]));
+        }
+    }
+    std::vector<uint64_t>().swap(keys);
+    reindex(merge_ids(edge_ids_, ids));
+    
+    size_t n = edge_ids_.size();
+    const EdgeMeta blank;
+    std::vector<uint64_t> incoming_cell(n, blank.incoming_cell), outgoing_cell(n, blank.outgoing_cell);
+    std::vector<int32_t> lca_res(n, blank.lca_res);
+    std::vector<double> length(n, blank.length), cost(n, blank.cost);
+    std::vector<uint8_t> present(n, 0);
+    // ids is a sorted subset of edge_ids_, so indices come from a merge walk
+    for (size_t k = 0, idx = 0; k < ids.size(); ++k) {
+        while (edge_ids_[idx] < ids[k]) ++idx;
+        uint32_t r = winner[k];
+        incoming_cell[idx] = rows.incoming_cell[r];
+        outgoing_cell[idx] = rows.outgoing_cell[r];
+        lca_res[idx] = rows.lca_res[r];
+        length[idx] = rows.length[r];
+        cost[idx] = rows.cost[r];
+        present[idx] = 1;
+    }
+    meta_.incoming_cell = std::move(incoming_cell);
+    meta_.outgoing_cell = std::move(outgoing_cell);
+    meta_.lca_res = std::move(lca_res);
+    meta_.length = std::move(length);
+    meta_.cost = std::move(cost);
+    meta_.present = std::move(present);
+    meta_count_ = ids.size();
+    build_lca_cells();
+    build_sweep();
+    aggregate_lengths();
+    
+    return meta_count_ > 0;
 }
 
-HighCell ShortcutGraph::compute_high_cell(uint32_t source_edge, uint32_t target_edge) const {
-    auto src_it = edge_meta_.find(source_edge);
-    auto dst_it = edge_meta_.find(target_edge);
+// Fixed-size scalars stored in the GRAPH_INFO section
+struct GraphInfo {
+    uint64_t shortcut_count;
+    uint64_t meta_count;
+    uint32_t fwd_parts;
+    uint32_t bwd_parts;
+};
+
+bool ShortcutGraph::save_snapshot(const std::string& path) const {
+    GraphInfo info{shortcut_count_, meta_count_, fwd_.parts, bwd_.parts};
     
-    if (src_it == edge_meta_.end() || dst_it == edge_meta_.end()) {
-        return {0, -1};
+    snapshot::Writer w;
+    w.add(snapshot::GRAPH_INFO, &info, 1);
+    w.add(snapshot::EDGE_IDS, edge_ids_.data(), edge_ids_.size());
+    w.add(snapshot::FWD_OFFSETS, fwd_.offsets.data(), fwd_.offsets.size());
+    w.add(snapshot::FWD_ARCS, fwd_.arcs.data(), fwd_.arcs.size());
+    w.add(snapshot::FWD_VIA_EDGE, fwd_.via_edge.data(), fwd_.via_edge.size());
+    w.add(snapshot::FWD_CELL, fwd_.cell.data(), fwd_.cell.size());
+    w.add(snapshot::BWD_OFFSETS, bwd_.offsets.data(), bwd_.offsets.size());
+    w.add(snapshot::BWD_ARCS, bwd_.arcs.data(), bwd_.arcs.size());
+    w.add(snapshot::BWD_VIA_EDGE, bwd_.via_edge.data(), bwd_.via_edge.size());
+    w.add(snapshot::BWD_CELL, bwd_.cell.data(), bwd_.cell.size());
+    w.add(snapshot::SHORTCUT_INDEX, shortcut_index_.slots.data(), shortcut_index_.slots.size());
+    w.add(snapshot::FWD_LENGTH, fwd_.length.data(), fwd_.length.size());
+    w.add(snapshot::BWD_LENGTH, bwd_.length.data(), bwd_.length.size());
+    w.add(snapshot::SWEEP_ORDER, sweep_order_.data(), sweep_order_.size());
+    w.add(snapshot::SWEEP_POSITION, sweep_position_.data(), sweep_position_.size());
+    w.add(snapshot::SWEEP_OFFSETS, sweep_.offsets.data(), sweep_.offsets.size());
+    w.add(snapshot::SWEEP_ARCS, sweep_.arcs.data(), sweep_.arcs.size());
+    w.add(snapshot::SWEEP_CYCLIC, sweep_cyclic_.data(), sweep_cyclic_.size());
+    w.add(snapshot::META_INCOMING_CELL, meta_.incoming_cell.data(), meta_.incoming_cell.size());
+    w.add(snapshot::META_OUTGOING_CELL, meta_.outgoing_cell.data(), meta_.outgoing_cell.size());
+    w.add(snapshot::META_LCA_RES, meta_.lca_res.data(), meta_.lca_res.size());
+    w.add(snapshot::META_LENGTH, meta_.length.data(), meta_.length.size());
+    w.add(snapshot::META_COST, meta_.cost.data(), meta_.cost.size());
+    w.add(snapshot::META_PRESENT, meta_.present.data(), meta_.present.size());
+    w.add(snapshot::META_LCA_CELL, meta_.lca_cell.data(), meta_.lca_cell.size());
+    return w.write(path);
+}
+
+bool ShortcutGraph::load_snapshot(const std::string& path, bool verify) {
+    using snapshot::Mapping;
+    
+    auto m = Mapping::open(path);
+    if (!m || (verify && !m->verify())) return false;
+    
+    auto info = Mapping::view<GraphInfo>(m, snapshot::GRAPH_INFO);
+    if (info.size() != 1) return false;
+    
+    ShortcutGraph g;
+    g.shortcut_count_ = info[0].shortcut_count;
+    g.meta_count_ = info[0].meta_count;
+    g.edge_ids_ = Mapping::view<uint32_t>(m, snapshot::EDGE_IDS);
+    g.fwd_.parts = info[0].fwd_parts;
+    g.fwd_.offsets = Mapping::view<uint32_t>(m, snapshot::FWD_OFFSETS);
+    g.fwd_.arcs = Mapping::view<Arc>(m, snapshot::FWD_ARCS);
+    g.fwd_.via_edge = Mapping::view<uint32_t>(m, snapshot::FWD_VIA_EDGE);
+    g.fwd_.cell = Mapping::view<uint64_t>(m, snapshot::FWD_CELL);
+    g.bwd_.parts = info[0].bwd_parts;
+    g.bwd_.offsets = Mapping::view<uint32_t>(m, snapshot::BWD_OFFSETS);
+    g.bwd_.arcs = Mapping::view<Arc>(m, snapshot::BWD_ARCS);
+    g.bwd_.via_edge = Mapping::view<uint32_t>(m, snapshot::BWD_VIA_EDGE);
+    g.bwd_.cell = Mapping::view<uint64_t>(m, snapshot::BWD_CELL);
+    g.shortcut_index_.slots = Mapping::view<ShortcutIndex::Slot>(m, snapshot::SHORTCUT_INDEX);
+    g.fwd_.length = Mapping::view<double>(m, snapshot::FWD_LENGTH);
+    g.bwd_.length = Mapping::view<double>(m, snapshot::BWD_LENGTH);
+    g.sweep_order_ = Mapping::view<uint32_t>(m, snapshot::SWEEP_ORDER);
+    g.sweep_position_ = Mapping::view<uint32_t>(m, snapshot::SWEEP_POSITION);
+    g.sweep_.offsets = Mapping::view<uint32_t>(m, snapshot::SWEEP_OFFSETS);
+    g.sweep_.arcs = Mapping::view<Arc>(m, snapshot::SWEEP_ARCS);
+    g.sweep_cyclic_ = Mapping::view<uint32_t>(m, snapshot::SWEEP_CYCLIC);
+    g.meta_.incoming_cell = Mapping::view<uint64_t>(m, snapshot::META_INCOMING_CELL);
+    g.meta_.outgoing_cell = Mapping::view<uint64_t>(m, snapshot::META_OUTGOING_CELL);
+    g.meta_.lca_res = Mapping::view<int32_t>(m, snapshot::META_LCA_RES);
+    g.meta_.length = Mapping::view<double>(m, snapshot::META_LENGTH);
+    g.meta_.cost = Mapping::view<double>(m, snapshot::META_COST);
+    g.meta_.present = Mapping::view<uint8_t>(m, snapshot::META_PRESENT);
+    g.meta_.lca_cell = Mapping::view<uint64_t>(m, snapshot::META_LCA_CELL);
+    
+    // Structural checks so a corrupt table cannot send queries out of bounds
+    size_t n = g.edge_ids_.size();
+    auto csr_ok = [&](const CsrGraph& c) {
+        return c.parts > 0 && c.offsets.size() == n * c.parts + 1 && c.offsets[n * c.parts] == c.arcs.size() &&
+               c.via_edge.size() == c.arcs.size() && c.cell.size() == c.arcs.size() &&
+               c.length.size() == c.arcs.size();
+    };
+    // Queries index the backward CSR by part, so a file with the part
+    // counts changed and the two CSRs swapped must not pass as consistent
+    if (g.fwd_.parts != 1 || g.bwd_.parts != BWD_PARTS) return false;
+    if (!csr_ok(g.fwd_) || !csr_ok(g.bwd_)) return false;
+    if (g.sweep_order_.size() != n || g.sweep_position_.size() != n || g.sweep_.offsets.size() != n + 1 ||
+        g.sweep_.offsets[n] != g.sweep_.arcs.size() || g.sweep_cyclic_.size() % 2 != 0) {
+        return false;
+    }
+    size_t slots = g.shortcut_index_.slots.size();
+    if (slots < 16 || (slots & (slots - 1)) != 0) return false;  // probing needs a power of two
+    for (size_t len : {g.meta_.incoming_cell.size(), g.meta_.outgoing_cell.size(), g.meta_.lca_res.size(),
+                       g.meta_.length.size(), g.meta_.cost.size(), g.meta_.present.size(),
+                       g.meta_.lca_cell.size()}) {
+        if (len != n) return false;
+    }
+    
+    // One pass over the index arrays: offsets ascend, every arc target,
+    // order entry, cyclic group and index slot stays inside its array, and
+    // arc costs are non-negative (a negative cycle would never settle)
+    auto offsets_ok = [](const MappedVector<uint32_t>& offsets) {
+        for (size_t i = 1; i < offsets.size(); ++i) {
+            if (offsets[i] < offsets[i - 1]) return false;
+        }
+        return true;
+    };
+    auto arcs_ok = [&](const MappedVector<Arc>& arcs) {
+        for (const Arc& a : arcs) {
+            if (a.target >= n || !(a.cost >= 0.0f)) return false;
+        }
+        return true;
+    };
+    auto entries_ok = [&](const MappedVector<uint32_t>& entries) {
+        for (uint32_t e : entries) {
+            if (e >= n) return false;
+        }
+        return true;
+    };
+    if (!offsets_ok(g.fwd_.offsets) || !offsets_ok(g.bwd_.offsets) || !offsets_ok(g.sweep_.offsets) ||
+        !arcs_ok(g.fwd_.arcs) || !arcs_ok(g.bwd_.arcs) || !arcs_ok(g.sweep_.arcs) ||
+        !entries_ok(g.sweep_order_) || !entries_ok(g.sweep_position_)) {
+        return false;
+    }
+    for (size_t i = 0; i < g.sweep_cyclic_.size(); i += 2) {
+        uint32_t first = g.sweep_cyclic_[i], end = g.sweep_cyclic_[i + 1];
+        if (first >= end || end > n || (i > 0 && first < g.sweep_cyclic_[i - 1])) return false;
+    }
+    size_t arc_count = g.fwd_.arcs.size() + g.bwd_.arcs.size();
+    bool has_empty = false;
+    for (const ShortcutIndex::Slot& slot : g.shortcut_index_.slots) {
+        if (slot.key == ShortcutIndex::EMPTY) {
+            has_empty = true;
+        } else if (slot.arc >= arc_count) {
+            return false;
+        }
     }
+    if (!has_empty) return false;  // probing stops only at an empty slot
     
-    uint64_t src_cell = src_it->second.incoming_cell;
-    uint64_t dst_cell = dst_it->second.incoming_cell;
-    int src_res = src_it->second.lca_res;
-    int dst_res = dst_it->second.lca_res;
+    g.cost_resolution_ = cost_resolution_;
+    g.layout_id_ = next_layout_id();
+    *this = std::move(g);
+    quantize_costs();
+    return true;
+}
+
+double ShortcutGraph::get_edge_cost(uint32_t edge_id) const {
+    uint32_t idx = index_of(edge_id);
+    return (idx != NO_INDEX) ? meta_.cost[idx] : 0.0;
+}
+
+double ShortcutGraph::get_edge_length(uint32_t edge_id) const {
+    uint32_t idx = index_of(edge_id);
+    return (idx != NO_INDEX) ? meta_.length[idx] : 0.0;
+}
+
+double ShortcutGraph::path_length(const std::vector<uint32_t>& path) const {
+    if (path.empty()) return 0.0;
     
+    size_t fwd_arcs = fwd_.arcs.size();
+    double total = get_edge_length(path.back());
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        uint32_t arc = shortcut_index_.find(path[i], path[i + 1]);
+        if (arc == ShortcutIndex::NONE) {
+            total += get_edge_length(path[i]);
+            continue;
+        }
+        double length = arc < fwd_arcs ? fwd_.length[arc] : bwd_.length[arc - fwd_arcs];
+        if (std::isnan(length)) {
+            // Deeper than the unpack limit: sum the hop's unpacked edges
+            std::vector<uint32_t> base = unpack_path({path[i], path[i + 1]});
+            length = 0.0;
+            for (size_t k = 0; k + 1 < base.size(); ++k) length += get_edge_length(base[k]);
+        }
+        total += length;
+    }
+    return total;
+}
+
+uint64_t ShortcutGraph::get_edge_cell(uint32_t edge_id) const {
+    uint32_t idx = index_of(edge_id);
+    return (idx != NO_INDEX) ? meta_.incoming_cell[idx] : 0;
+}
+
+// Each edge's incoming cell at its lca_res, so compute_high_cell is two reads
+void ShortcutGraph::build_lca_cells() {
+    size_t n = edge_ids_.size();
+    std::vector<uint64_t> lca_cell(n, 0);
+    for (size_t v = 0; v < n; ++v) {
+        if (!meta_.present[v]) continue;
+        int res = meta_.lca_res[v];
+        lca_cell[v] = res >= 0 ? h3_utils::cell_to_parent(meta_.incoming_cell[v], res) : meta_.incoming_cell[v];
+    }
+    meta_.lca_cell = std::move(lca_cell);
+}
+
+HighCell ShortcutGraph::compute_high_cell(uint32_t source, uint32_t target) const {
+    // 0 for edges without metadata or cell (global edges): no pruning
+    uint64_t src_cell = meta_.lca_cell[source];
+    uint64_t dst_cell = meta_.lca_cell[target];
     if (src_cell == 0 || dst_cell == 0) {
         return {0, -1};
     }
     
-    if (src_res >= 0) src_cell = h3_utils::cell_to_parent(src_cell, src_res);
-    if (dst_res >= 0) dst_cell = h3_utils::cell_to_parent(dst_cell, dst_res);
-    
     uint64_t lca = h3_utils::find_lca(src_cell, dst_cell);
-    int res = (lca != 0) ? h3_utils::get_resolution(lca) : -1;
-    return {lca, res};
+    return {lca, h3_utils::get_resolution(lca)};
 }
 
-QueryResult ShortcutGraph::query_classic(uint32_t source_edge, uint32_t target_edge) const {
-    constexpr double INF = std::numeric_limits<double>::infinity();
+std::vector<uint32_t> ShortcutGraph::reconstruct_path(uint32_t meeting, const QueryContext& ctx) const {
+    std::vector<uint32_t> path;
+    uint32_t curr = meeting;
+    while (ctx.fwd.parent(curr) != curr) {
+        path.push_back(edge_ids_[curr]);
+        curr = ctx.fwd.parent(curr);
+    }
+    path.push_back(edge_ids_[curr]);
+    std::reverse(path.begin(), path.end());
     
-    if (source_edge == target_edge) {
-        return {get_edge_cost(source_edge), {source_edge}, true};
+    curr = meeting;
+    while (ctx.bwd.parent(curr) != curr) {
+        curr = ctx.bwd.parent(curr);
+        path.push_back(edge_ids_[curr]);
     }
+    return path;
+}
+
+uint32_t ShortcutGraph::via_of(uint32_t from, uint32_t to) const {
+    uint32_t arc = shortcut_index_.find(from, to);
+    size_t fwd_arcs = fwd_.arcs.size();
+    if (arc == ShortcutIndex::NONE || arc >= fwd_arcs + bwd_.arcs.size()) return 0;
+    uint32_t via = arc < fwd_arcs ? fwd_.via_edge[arc] : bwd_.via_edge[arc - fwd_arcs];
+    return (via == from || via == to) ? 0 : via;
+}
+
+// Append the base edges after `from` on hop (from, to), ending with `to`
+void ShortcutGraph::unpack_hop(uint32_t from, uint32_t to, std::vector<uint32_t>& out, UnpackCache& cache) const {
+    uint32_t arc = cache.enabled() ? shortcut_index_.find(from, to) : ShortcutIndex::NONE;
+    if (arc != ShortcutIndex::NONE && cache.append(arc, out)) return;
     
-    std::unordered_map<uint32_t, double> dist_fwd, dist_bwd;
-    std::unordered_map<uint32_t, uint32_t> parent_fwd, parent_bwd;
-    MinHeap pq_fwd, pq_bwd;
+    size_t first = out.size();
+    cache.stack.clear();
+    cache.stack.push_back({from, to, 0});
+    while (!cache.stack.empty()) {
+        UnpackCache::Hop hop = cache.stack.back();
+        cache.stack.pop_back();
+        uint32_t via = hop.depth < MAX_UNPACK_DEPTH ? via_of(hop.from, hop.to) : 0;
+        if (via == 0) {
+            out.push_back(hop.to);
+            continue;
+        }
+        // (from, via) is expanded first, so it goes on top
+        cache.stack.push_back({via, hop.to, hop.depth + 1});
+        cache.stack.push_back({hop.from, via, hop.depth + 1});
+    }
     
-    dist_fwd[source_edge] = 0.0;
-    parent_fwd[source_edge] = source_edge;
-    pq_fwd.push({0.0, source_edge});
+    if (arc != ShortcutIndex::NONE) cache.insert(arc, out.data() + first, out.size() - first);
+}
+
+std::vector<uint32_t> ShortcutGraph::unpack_path(const std::vector<uint32_t>& path) const {
+    return unpack_path(path, thread_context());
+}
+
+std::vector<uint32_t> ShortcutGraph::unpack_path(const std::vector<uint32_t>& path, QueryContext& ctx) const {
+    std::vector<uint32_t> out;
+    if (path.empty()) return out;
     
-    double target_cost = get_edge_cost(target_edge);
-    dist_bwd[target_edge] = target_cost;
-    parent_bwd[target_edge] = target_edge;
-    pq_bwd.push({target_cost, target_edge});
+    ctx.unpack.bind(layout_id_);
+    out.push_back(path[0]);
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        unpack_hop(path[i], path[i + 1], out, ctx.unpack);
+    }
+    return out;
+}
+
+QueryResult ShortcutGraph::query_classic(uint32_t source_edge, uint32_t target_edge) const {
+    return query_classic(source_edge, target_edge, thread_context());
+}
+
+// Policies of bidirectional_search. A filter maps a popped node to the arcs
+// it expands; a stop policy says where meetings are detected and when the
+// loop ends.
+namespace {
+
+struct ArcRange {
+    const Arc* first;
+    const Arc* last;
+};
+
+// Forward: every upward arc
+struct UpArcs {
+    const CsrGraph& fwd;
+    ArcRange operator()(uint32_t u) const { return {fwd.begin(u), fwd.end(u)}; }
+};
+
+// Backward: downward and lateral arcs
+struct DownLateralArcs {
+    const CsrGraph& bwd;
+    ArcRange operator()(uint32_t u) const { return {bwd.begin(u, BWD_DOWN), bwd.end(u, BWD_LATERAL)}; }
+};
+
+// Forward, pruned: nothing from nodes outside the high cell
+struct PrunedUpArcs {
+    const CsrGraph& fwd;
+    const uint64_t* cell;
+    HighCell high;
+    ArcRange operator()(uint32_t u) const {
+        if (!h3_utils::parent_check(cell[u], high.cell, high.res)) return {nullptr, nullptr};
+        return {fwd.begin(u), fwd.end(u)};
+    }
+};
+
+// Backward, pruned: downward when the check passes, lateral at the high
+// cell or when it fails, outer only when it fails
+struct PrunedDownArcs {
+    const CsrGraph& bwd;
+    const uint64_t* cell;
+    HighCell high;
+    ArcRange operator()(uint32_t u) const {
+        bool check = h3_utils::parent_check(cell[u], high.cell, high.res);
+        bool at_high = (cell[u] == high.cell);
+        uint32_t first = check ? BWD_DOWN : BWD_LATERAL;
+        uint32_t last = !check ? BWD_OUTER : (at_high ? BWD_LATERAL : BWD_DOWN);
+        return {bwd.begin(u, first), bwd.end(u, last)};
+    }
+};
+
+// Meet on relaxation; stop once both queues are at or above best
+struct StopBothAbove {
+    static constexpr bool MEET_ON_RELAX = true;
+    static bool done(SearchSpace& fwd, SearchSpace& bwd, double best) {
+        if (!fwd.heap.empty() && !bwd.heap.empty()) {
+            return fwd.heap.top().dist >= best && bwd.heap.top().dist >= best;
+        }
+        return fwd.heap.empty() && bwd.heap.empty();
+    }
+};
+
+// Meet on pop; stop once a path is known and neither queue can improve it
+struct StopNeitherImproves {
+    static constexpr bool MEET_ON_RELAX = false;
+    static bool done(SearchSpace& fwd, SearchSpace& bwd, double best) {
+        if (best == std::numeric_limits<double>::infinity()) return false;
+        bool fwd_can = !fwd.heap.empty() && fwd.heap.top().dist < best;
+        bool bwd_can = !bwd.heap.empty() && bwd.heap.top().dist < best;
+        return !fwd_can && !bwd_can;
+    }
+};
+
+// Meet on pop; stop each side once its top plus the other side's floor
+// reaches best. Keys include the seed offsets and every label on a side is
+// at least that side's smallest seed, so a path meeting at a node the side
+// has not popped costs at least top + floor; paths through nodes popped on
+// both sides were met when the second side popped them.
+struct StopSideBounds {
+    static constexpr bool MEET_ON_RELAX = false;
+    double fwd_floor;
+    double bwd_floor;
+    bool done(SearchSpace& fwd, SearchSpace& bwd, double best) const {
+        if (!fwd.heap.empty() && fwd.heap.top().dist + bwd_floor >= best) fwd.heap.clear();
+        if (!bwd.heap.empty() && bwd.heap.top().dist + fwd_floor >= best) bwd.heap.clear();
+        return fwd.heap.empty() && bwd.heap.empty();
+    }
+};
+
+}  // namespace
+
+// Alternating bidirectional search from the labels already seeded in ctx.
+// Policies are resolved at compile time, so each combination is its own
+// specialized loop.
+template <typename ForwardFilter, typename BackwardFilter, typename StopPolicy, bool TrackParents>
+ShortcutGraph::SearchOutcome ShortcutGraph::bidirectional_search(const ForwardFilter& forward,
+                                                                 const BackwardFilter& backward,
+                                                                 const StopPolicy& stop,
+                                                                 QueryContext& ctx) const {
+    SearchSpace& fwd = ctx.fwd;
+    SearchSpace& bwd = ctx.bwd;
     
-    double best = INF;
+    double best = std::numeric_limits<double>::infinity();
     uint32_t meeting = 0;
     bool found = false;
+    auto meet = [&](uint32_t v, double total) {
+        if (total < best) {
+            best = total;
+            meeting = v;
+            found = true;
+        }
+    };
     
-    while (!pq_fwd.empty() || !pq_bwd.empty()) {
-        // Forward step
-        if (!pq_fwd.empty()) {
-            auto [d, u] = pq_fwd.top(); pq_fwd.pop();
-            
-            auto it = dist_fwd.find(u);
-            if (it != dist_fwd.end() && d > it->second) continue;
-            if (d >= best) continue;
-            
-            auto adj_it = fwd_adj_.find(u);
-            if (adj_it != fwd_adj_.end()) {
-                for (size_t idx : adj_it->second) {
-                    const Shortcut& sc = shortcuts_[idx];
-                    if (sc.inside != 1) continue;
-                    
-                    double nd = d + sc.cost;
-                    auto v_it = dist_fwd.find(sc.to);
-                    if (v_it == dist_fwd.end() || nd < v_it->second) {
-                        dist_fwd[sc.to] = nd;
-                        parent_fwd[sc.to] = u;
-                        pq_fwd.push({nd, sc.to});
-                        
-                        auto bwd_it = dist_bwd.find(sc.to);
-                        if (bwd_it != dist_bwd.end()) {
-                            double total = nd + bwd_it->second;
-                            if (total < best) {
-                                best = total;
-                                meeting = sc.to;
-                                found = true;
-                            }
-                        }
-                    }
-                }
-            }
+    auto step = [&](SearchSpace& self, const SearchSpace& other, const auto& filter) {
+        auto [d, u] = self.heap.pop();
+        if constexpr (!StopPolicy::MEET_ON_RELAX) {
+            if (other.reached(u)) meet(u, d + other.dist(u));
         }
         
-        // Backward step
-        if (!pq_bwd.empty()) {
-            auto [d, u] = pq_bwd.top(); pq_bwd.pop();
-            
-            auto it = dist_bwd.find(u);
-            if (it != dist_bwd.end() && d > it->second) continue;
-            if (d >= best) continue;
-            
-            auto adj_it = bwd_adj_.find(u);
-            if (adj_it != bwd_adj_.end()) {
-                for (size_t idx : adj_it->second) {
-                    const Shortcut& sc = shortcuts_[idx];
-                    if (sc.inside != -1 && sc.inside != 0) continue;
-                    
-                    double nd = d + sc.cost;
-                    auto prev_it = dist_bwd.find(sc.from);
-                    if (prev_it == dist_bwd.end() || nd < prev_it->second) {
-                        dist_bwd[sc.from] = nd;
-                        parent_bwd[sc.from] = u;
-                        pq_bwd.push({nd, sc.from});
-                        
-                        auto fwd_it = dist_fwd.find(sc.from);
-                        if (fwd_it != dist_fwd.end()) {
-                            double total = fwd_it->second + nd;
-                            if (total < best) {
-                                best = total;
-                                meeting = sc.from;
-                                found = true;
-                            }
-                        }
-                    }
+        if (d >= best) return;
+        
+        ArcRange arcs = filter(u);
+        for (const Arc* a = arcs.first; a != arcs.last; ++a) {
+            double nd = d + a->cost;
+            if (nd < self.dist(a->target)) {
+                set_label<TrackParents>(self, a->target, nd, u);
+                self.heap.push_or_decrease(a->target, nd);
+                if constexpr (StopPolicy::MEET_ON_RELAX) {
+                    if (other.reached(a->target)) meet(a->target, nd + other.dist(a->target));
                 }
             }
         }
-        
-        // Early termination
-        if (!pq_fwd.empty() && !pq_bwd.empty()) {
-            if (pq_fwd.top().dist >= best && pq_bwd.top().dist >= best) break;
-        } else if (pq_fwd.empty() && pq_bwd.empty()) {
-            break;
-        }
-    }
-    
-    if (!found) return {-1, {}, false};
+    };
     
-    // Reconstruct path
-    std::vector<uint32_t> path;
-    uint32_t curr = meeting;
-    while (parent_fwd[curr] != curr) {
-        path.push_back(curr);
-        curr = parent_fwd[curr];
+    while (!fwd.heap.empty() || !bwd.heap.empty()) {
+        if (!fwd.heap.empty()) step(fwd, bwd, forward);
+        if (!bwd.heap.empty()) step(bwd, fwd, backward);
+        if (stop.done(fwd, bwd, best)) break;
     }
-    path.push_back(curr);
-    std::reverse(path.begin(), path.end());
     
-    curr = meeting;
-    while (parent_bwd[curr] != curr) {
-        curr = parent_bwd[curr];
-        path.push_back(curr);
-    }
-    
-    return {best, path, true};
+    return {best, meeting, found};
 }
 
-QueryResult ShortcutGraph::query_pruned(uint32_t source_edge, uint32_t target_edge) const {
-    constexpr double INF = std::numeric_limits<double>::infinity();
+// Pair search labels: the source at 0, the target at its own cost
+template <bool TrackParents>
+void ShortcutGraph::seed_pair(uint32_t source, uint32_t target, QueryContext& ctx) const {
+    ctx.prepare(edge_ids_.size());
+    set_label<TrackParents>(ctx.fwd, source, 0.0, source);
+    ctx.fwd.heap.push_or_decrease(source, 0.0);
     
-    if (source_edge == target_edge) {
-        return {get_edge_cost(source_edge), {source_edge}, true};
+    double target_cost = meta_.cost[target];
+    set_label<TrackParents>(ctx.bwd, target, target_cost, target);
+    ctx.bwd.heap.push_or_decrease(target, target_cost);
+}
+
+template <bool TrackParents>
+ShortcutGraph::SearchOutcome ShortcutGraph::search_classic(uint32_t source, uint32_t target, QueryContext& ctx) const {
+    seed_pair<TrackParents>(source, target, ctx);
+    return bidirectional_search<UpArcs, DownLateralArcs, StopBothAbove, TrackParents>({fwd_}, {bwd_}, {}, ctx);
+}
+
+void ShortcutGraph::set_cost_resolution(double resolution) {
+    cost_resolution_ = resolution > 0.0 ? resolution : 0.0;
+    quantize_costs();
+}
+
+uint64_t ShortcutGraph::quantize(double cost) const {
+    double q = std::round(cost / cost_resolution_);
+    return q <= 0.0 ? 0 : static_cast<uint64_t>(std::min(q, double(UINT32_MAX)));
+}
+
+void ShortcutGraph::quantize_costs() {
+    for (CsrGraph* csr : {&fwd_, &bwd_}) {
+        if (cost_resolution_ == 0.0) {
+            csr->qcost = {};
+            continue;
+        }
+        std::vector<uint32_t> qcost(csr->arcs.size());
+        for (size_t i = 0; i < qcost.size(); ++i) {
+            qcost[i] = static_cast<uint32_t>(quantize(csr->arcs[i].cost));
+        }
+        csr->qcost = std::move(qcost);
     }
+}
+
+ShortcutGraph::SearchOutcome ShortcutGraph::search_classic_quantized(uint32_t source, uint32_t target, QueryContext& ctx) const {
+    if (cost_resolution_ == 0.0) return {-1, 0, false};
     
-    HighCell high = compute_high_cell(source_edge, target_edge);
-    
-    std::unordered_map<uint32_t, double> dist_fwd, dist_bwd;
-    std::unordered_map<uint32_t, uint32_t> parent_fwd, parent_bwd;
-    MinHeap pq_fwd, pq_bwd;
+    ctx.prepare(edge_ids_.size());
+    SearchSpace& fwd = ctx.fwd;
+    SearchSpace& bwd = ctx.bwd;
     
-    dist_fwd[source_edge] = 0.0;
-    parent_fwd[source_edge] = source_edge;
-    pq_fwd.push({0.0, source_edge});
+    // Labels hold integer distances, exact in double below 2^53
+    fwd.set(source, 0.0, source);
+    fwd.radix.push(0, source);
     
-    double target_cost = get_edge_cost(target_edge);
-    dist_bwd[target_edge] = target_cost;
-    parent_bwd[target_edge] = target_edge;
-    pq_bwd.push({target_cost, target_edge});
+    uint64_t target_cost = quantize(meta_.cost[target]);
+    bwd.set(target, double(target_cost), target);
+    bwd.radix.push(target_cost, target);
     
-    double best = INF;
+    uint64_t best = UINT64_MAX;
     uint32_t meeting = 0;
-    bool found = false;
     
-    while (!pq_fwd.empty() || !pq_bwd.empty()) {
+    while (!fwd.radix.empty() || !bwd.radix.empty()) {
         // Forward step
-        if (!pq_fwd.empty()) {
-            auto [d, u] = pq_fwd.top(); pq_fwd.pop();
+        if (!fwd.radix.empty()) {
+            auto [d, u] = fwd.radix.pop();
             
-            // Check meeting
-            auto bwd_it = dist_bwd.find(u);
-            if (bwd_it != dist_bwd.end()) {
-                double total = d + bwd_it->second;
-                if (total < best) {
-                    best = total;
-                    meeting = u;
-                    found = true;
-                }
-            }
-            
-            auto it = dist_fwd.find(u);
-            if (it != dist_fwd.end() && d > it->second) continue;
+            if (double(d) > fwd.dist(u)) continue;  // Stale entry
             if (d >= best) continue;
             
-            // Pruning
-            uint64_t u_cell = get_edge_cell(u);
-            if (!h3_utils::parent_check(u_cell, high.cell, high.res)) continue;
-            
-            auto adj_it = fwd_adj_.find(u);
-            if (adj_it != fwd_adj_.end()) {
-                for (size_t idx : adj_it->second) {
-                    const Shortcut& sc = shortcuts_[idx];
-                    if (sc.inside != 1) continue;
+            const uint32_t* q = fwd_.qcost.data() + (fwd_.begin(u) - fwd_.arcs.data());
+            for (const Arc* a = fwd_.begin(u); a != fwd_.end(u); ++a, ++q) {
+                uint64_t nd = d + *q;
+                if (double(nd) < fwd.dist(a->target)) {
+                    fwd.set(a->target, double(nd), u);
+                    fwd.radix.push(nd, a->target);
                     
-                    double nd = d + sc.cost;
-                    auto v_it = dist_fwd.find(sc.to);
-                    if (v_it == dist_fwd.end() || nd < v_it->second) {
-                        dist_fwd[sc.to] = nd;
-                        parent_fwd[sc.to] = u;
-                        pq_fwd.push({nd, sc.to});
+                    if (bwd.reached(a->target)) {
+                        uint64_t total = nd + static_cast<uint64_t>(bwd.dist(a->target));
+                        if (total < best) {
+                            best = total;
+                            meeting = a->target;
+                        }
                     }
                 }
             }
         }
         
         // Backward step
-        if (!pq_bwd.empty()) {
-            auto [d, u] = pq_bwd.top(); pq_bwd.pop();
+        if (!bwd.radix.empty()) {
+            auto [d, u] = bwd.radix.pop();
             
-            // Check meeting
-            auto fwd_it = dist_fwd.find(u);
-            if (fwd_it != dist_fwd.end()) {
-                double total = fwd_it->second + d;
-                if (total < best) {
-                    best = total;
-                    meeting = u;
-                    found = true;
-                }
-            }
-            
-            auto it = dist_bwd.find(u);
-            if (it != dist_bwd.end() && d > it->second) continue;
+            if (double(d) > bwd.dist(u)) continue;  // Stale entry
             if (d >= best) continue;
             
-            // Pruning
-            uint64_t u_cell = get_edge_cell(u);
-            bool check = h3_utils::parent_check(u_cell, high.cell, high.res);
-            bool at_high = (u_cell == high.cell);
-            
-            auto adj_it = bwd_adj_.find(u);
-            if (adj_it != bwd_adj_.end()) {
-                for (size_t idx : adj_it->second) {
-                    const Shortcut& sc = shortcuts_[idx];
+            const Arc* end = bwd_.end(u, BWD_LATERAL);
+            const uint32_t* q = bwd_.qcost.data() + (bwd_.begin(u, BWD_DOWN) - bwd_.arcs.data());
+            for (const Arc* a = bwd_.begin(u, BWD_DOWN); a != end; ++a, ++q) {
+                uint64_t nd = d + *q;
+                if (double(nd) < bwd.dist(a->target)) {
+                    bwd.set(a->target, double(nd), u);
+                    bwd.radix.push(nd, a->target);
                     
-                    // Backward filtering
-                    bool allowed = false;
-                    if (sc.inside == -1 && check) allowed = true;
-                    else if (sc.inside == 0 && (at_high || !check)) allowed = true;
-                    else if (sc.inside == -2 && !check) allowed = true;
-                    
-                    if (!allowed) continue;
-                    
-                    double nd = d + sc.cost;
-                    auto prev_it = dist_bwd.find(sc.from);
-                    if (prev_it == dist_bwd.end() || nd < prev_it->second) {
-                        dist_bwd[sc.from] = nd;
-                        parent_bwd[sc.from] = u;
-                        pq_bwd.push({nd, sc.from});
+                    if (fwd.reached(a->target)) {
+                        uint64_t total = static_cast<uint64_t>(fwd.dist(a->target)) + nd;
+                        if (total < best) {
+                            best = total;
+                            meeting = a->target;
+                        }
                     }
                 }
             }
         }
         
         // Early termination
-        if (best < INF) {
-            bool fwd_can = !pq_fwd.empty() && pq_fwd.top().dist < best;
-            bool bwd_can = !pq_bwd.empty() && pq_bwd.top().dist < best;
-            if (!fwd_can && !bwd_can) break;
+        if (!fwd.radix.empty() && !bwd.radix.empty()) {
+            if (fwd.radix.min_key() >= best && bwd.radix.min_key() >= best) break;
+        } else if (fwd.radix.empty() && bwd.radix.empty()) {
+            break;
         }
     }
     
-    if (!found) return {-1, {}, false};
-    
-    // Reconstruct path
-    std::vector<uint32_t> path;
-    uint32_t curr = meeting;
-    while (parent_fwd[curr] != curr) {
-        path.push_back(curr);
-        curr = parent_fwd[curr];
-    }
-    path.push_back(curr);
-    std::reverse(path.begin(), path.end());
-    
-    curr = meeting;
-    while (parent_bwd[curr] != curr) {
-        curr = parent_bwd[curr];
-        path.push_back(curr);
-    }
-    
-    return {best, path, true};
+    return {double(best) * cost_resolution_, meeting, best != UINT64_MAX};
+}
+
+QueryResult ShortcutGraph::query_pruned(uint32_t source_edge, uint32_t target_edge) const {
+    return query_pruned(source_edge, target_edge, thread_context());
+}
+
+template <bool TrackParents>
+ShortcutGraph::SearchOutcome ShortcutGraph::search_pruned(uint32_t source, uint32_t target, QueryContext& ctx) const {
+    HighCell high = compute_high_cell(source, target);
+    seed_pair<TrackParents>(source, target, ctx);
+    const uint64_t* cell = meta_.incoming_cell.data();
+    return bidirectional_search<PrunedUpArcs, PrunedDownArcs, StopNeitherImproves, TrackParents>(
+        {fwd_, cell, high}, {bwd_, cell, high}, {}, ctx);
 }
 
 QueryResult ShortcutGraph::query_multi(
@@ -455,123 +1179,431 @@ QueryResult ShortcutGraph::query_multi(
     const std::vector<uint32_t>& target_edges,
     const std::vector<double>& target_dists
 ) const {
-    constexpr double INF = std::numeric_limits<double>::infinity();
-    
-    std::unordered_map<uint32_t, double> dist_fwd, dist_bwd;
-    std::unordered_map<uint32_t, uint32_t> parent_fwd, parent_bwd;
-    MinHeap pq_fwd, pq_bwd;
+    return query_multi(source_edges, source_dists, target_edges, target_dists, thread_context());
+}
+
+template <bool TrackParents>
+ShortcutGraph::SearchOutcome ShortcutGraph::search_multi(
+    const std::vector<uint32_t>& source_edges,
+    const std::vector<double>& source_dists,
+    const std::vector<uint32_t>& target_edges,
+    const std::vector<double>& target_dists,
+    QueryContext& ctx
+) const {
+    // Metadata without shortcuts: nothing to search
+    if (fwd_.offsets.empty()) return {std::numeric_limits<double>::infinity(), 0, false};
+    ctx.prepare(edge_ids_.size());
+    SearchSpace& fwd = ctx.fwd;
+    SearchSpace& bwd = ctx.bwd;
     
     // Initialize from all sources
     for (size_t i = 0; i < source_edges.size(); ++i) {
-        uint32_t src = source_edges[i];
+        uint32_t src = index_of(source_edges[i]);
         double d = source_dists[i];
-        if (edge_meta_.find(src) != edge_meta_.end()) {
-            dist_fwd[src] = d;
-            parent_fwd[src] = src;
-            pq_fwd.push({d, src});
+        if (src != NO_INDEX && meta_.present[src] && d < fwd.dist(src)) {
+            set_label<TrackParents>(fwd, src, d, src);
+            fwd.heap.push_or_decrease(src, d);
         }
     }
     
     // Initialize from all targets
     for (size_t i = 0; i < target_edges.size(); ++i) {
-        uint32_t tgt = target_edges[i];
-        double d = target_dists[i] + get_edge_cost(tgt);
-        if (edge_meta_.find(tgt) != edge_meta_.end()) {
-            dist_bwd[tgt] = d;
-            parent_bwd[tgt] = tgt;
-            pq_bwd.push({d, tgt});
+        uint32_t tgt = index_of(target_edges[i]);
+        if (tgt != NO_INDEX && meta_.present[tgt]) {
+            double d = target_dists[i] + meta_.cost[tgt];
+            if (d < bwd.dist(tgt)) {
+                set_label<TrackParents>(bwd, tgt, d, tgt);
+                bwd.heap.push_or_decrease(tgt, d);
+            }
         }
     }
     
-    double best = INF;
-    uint32_t meeting = 0;
-    bool found = false;
+    // Without a seed on each side there is nothing to meet
+    if (fwd.heap.empty() || bwd.heap.empty()) return {std::numeric_limits<double>::infinity(), 0, false};
+    StopSideBounds stop{fwd.heap.top().dist, bwd.heap.top().dist};
+    return bidirectional_search<UpArcs, DownLateralArcs, StopSideBounds, TrackParents>({fwd_}, {bwd_}, stop, ctx);
+}
+
+// Front end of the pair queries: trivial and unindexed pairs, then the search
+QueryResult ShortcutGraph::pair_path(uint32_t source_edge, uint32_t target_edge, PairSearch search,
+                                     QueryContext& ctx) const {
+    if (source_edge == target_edge) {
+        return {get_edge_cost(source_edge), {source_edge}, true, get_edge_length(source_edge)};
+    }
     
-    while (!pq_fwd.empty() || !pq_bwd.empty()) {
-        // Forward step
-        if (!pq_fwd.empty()) {
-            auto [d, u] = pq_fwd.top(); pq_fwd.pop();
-            
-            auto bwd_it = dist_bwd.find(u);
-            if (bwd_it != dist_bwd.end() && d + bwd_it->second < best) {
-                best = d + bwd_it->second;
-                meeting = u;
-                found = true;
-            }
-            
-            if (d >= best || d > dist_fwd[u]) continue;
-            
-            auto adj_it = fwd_adj_.find(u);
-            if (adj_it != fwd_adj_.end()) {
-                for (size_t idx : adj_it->second) {
-                    const Shortcut& sc = shortcuts_[idx];
-                    if (sc.inside != 1) continue;
-                    
-                    double nd = d + sc.cost;
-                    auto v_it = dist_fwd.find(sc.to);
-                    if (v_it == dist_fwd.end() || nd < v_it->second) {
-                        dist_fwd[sc.to] = nd;
-                        parent_fwd[sc.to] = u;
-                        pq_fwd.push({nd, sc.to});
-                    }
-                }
-            }
-        }
+    uint32_t source = index_of(source_edge);
+    uint32_t target = index_of(target_edge);
+    if (source == NO_INDEX || target == NO_INDEX) return {-1, {}, false};
+    if (fwd_.offsets.empty()) return {-1, {}, false};  // metadata without shortcuts
+    
+    SearchOutcome r = (this->*search)(source, target, ctx);
+    if (!r.found) return {-1, {}, false};
+    std::vector<uint32_t> path = reconstruct_path(r.meeting, ctx);
+    double length = path_length(path);
+    return {r.distance, std::move(path), true, length};
+}
+
+DistanceResult ShortcutGraph::pair_distance(uint32_t source_edge, uint32_t target_edge, PairSearch search,
+                                            QueryContext& ctx) const {
+    if (source_edge == target_edge) {
+        return {get_edge_cost(source_edge), source_edge, true};
+    }
+    
+    uint32_t source = index_of(source_edge);
+    uint32_t target = index_of(target_edge);
+    if (source == NO_INDEX || target == NO_INDEX) return {-1, 0, false};
+    if (fwd_.offsets.empty()) return {-1, 0, false};  // metadata without shortcuts
+    
+    SearchOutcome r = (this->*search)(source, target, ctx);
+    if (!r.found) return {-1, 0, false};
+    return {r.distance, edge_ids_[r.meeting], true};
+}
+
+QueryResult ShortcutGraph::query_classic(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const {
+    return pair_path(source_edge, target_edge, &ShortcutGraph::search_classic<true>, ctx);
+}
+
+QueryResult ShortcutGraph::query_pruned(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const {
+    return pair_path(source_edge, target_edge, &ShortcutGraph::search_pruned<true>, ctx);
+}
+
+QueryResult ShortcutGraph::query_classic_quantized(uint32_t source_edge, uint32_t target_edge) const {
+    return query_classic_quantized(source_edge, target_edge, thread_context());
+}
+
+QueryResult ShortcutGraph::query_classic_quantized(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const {
+    return pair_path(source_edge, target_edge, &ShortcutGraph::search_classic_quantized, ctx);
+}
+
+QueryResult ShortcutGraph::query_multi(
+    const std::vector<uint32_t>& source_edges,
+    const std::vector<double>& source_dists,
+    const std::vector<uint32_t>& target_edges,
+    const std::vector<double>& target_dists,
+    QueryContext& ctx
+) const {
+    SearchOutcome r = search_multi<true>(source_edges, source_dists, target_edges, target_dists, ctx);
+    if (!r.found) return {-1, {}, false};
+    std::vector<uint32_t> path = reconstruct_path(r.meeting, ctx);
+    double length = path_length(path);
+    return {r.distance, std::move(path), true, length};
+}
+
+DistanceResult ShortcutGraph::distance_classic(uint32_t source_edge, uint32_t target_edge) const {
+    return distance_classic(source_edge, target_edge, thread_context());
+}
+
+DistanceResult ShortcutGraph::distance_classic(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const {
+    return pair_distance(source_edge, target_edge, &ShortcutGraph::search_classic<false>, ctx);
+}
+
+DistanceResult ShortcutGraph::distance_pruned(uint32_t source_edge, uint32_t target_edge) const {
+    return distance_pruned(source_edge, target_edge, thread_context());
+}
+
+DistanceResult ShortcutGraph::distance_pruned(uint32_t source_edge, uint32_t target_edge, QueryContext& ctx) const {
+    return pair_distance(source_edge, target_edge, &ShortcutGraph::search_pruned<false>, ctx);
+}
+
+DistanceResult ShortcutGraph::distance_multi(
+    const std::vector<uint32_t>& source_edges,
+    const std::vector<double>& source_dists,
+    const std::vector<uint32_t>& target_edges,
+    const std::vector<double>& target_dists
+) const {
+    return distance_multi(source_edges, source_dists, target_edges, target_dists, thread_context());
+}
+
+DistanceResult ShortcutGraph::distance_multi(
+    const std::vector<uint32_t>& source_edges,
+    const std::vector<double>& source_dists,
+    const std::vector<uint32_t>& target_edges,
+    const std::vector<double>& target_dists,
+    QueryContext& ctx
+) const {
+    SearchOutcome r = search_multi<false>(source_edges, source_dists, target_edges, target_dists, ctx);
+    if (!r.found) return {-1, 0, false};
+    return {r.distance, edge_ids_[r.meeting], true};
+}
+
+// Search from the labels already in space over arc classes [first_part,
+// last_part] of csr, up to distance limit; visit(node, dist) once per settled node
+template <typename Visit>
+void ShortcutGraph::settle_all(SearchSpace& space, const CsrGraph& csr, uint32_t first_part, uint32_t last_part,
+                               double limit, Visit&& visit) const {
+    bool has_arcs = !csr.offsets.empty();  // empty before shortcuts are loaded
+    while (!space.heap.empty()) {
+        auto [d, u] = space.heap.pop();
+        if (d > limit) break;
+        visit(u, d);
+        if (!has_arcs) continue;
         
-        // Backward step
-        if (!pq_bwd.empty()) {
-            auto [d, u] = pq_bwd.top(); pq_bwd.pop();
-            
-            auto fwd_it = dist_fwd.find(u);
-            if (fwd_it != dist_fwd.end() && fwd_it->second + d < best) {
-                best = fwd_it->second + d;
-                meeting = u;
-                found = true;
-            }
-            
-            if (d >= best || d > dist_bwd[u]) continue;
-            
-            auto adj_it = bwd_adj_.find(u);
-            if (adj_it != bwd_adj_.end()) {
-                for (size_t idx : adj_it->second) {
-                    const Shortcut& sc = shortcuts_[idx];
-                    if (sc.inside != -1 && sc.inside != 0) continue;
-                    
-                    double nd = d + sc.cost;
-                    auto prev_it = dist_bwd.find(sc.from);
-                    if (prev_it == dist_bwd.end() || nd < prev_it->second) {
-                        dist_bwd[sc.from] = nd;
-                        parent_bwd[sc.from] = u;
-                        pq_bwd.push({nd, sc.from});
-                    }
-                }
+        const Arc* end = csr.end(u, last_part);
+        for (const Arc* a = csr.begin(u, first_part); a != end; ++a) {
+            double nd = d + a->cost;
+            if (nd < space.dist(a->target)) {
+                space.set_dist(a->target, nd);
+                space.heap.push_or_decrease(a->target, nd);
             }
         }
-        
-        // Early termination
-        if (best < INF) {
-            if (!pq_fwd.empty() && pq_fwd.top().dist >= best) while (!pq_fwd.empty()) pq_fwd.pop();
-            if (!pq_bwd.empty() && pq_bwd.top().dist >= best) while (!pq_bwd.empty()) pq_bwd.pop();
+    }
+}
+
+std::vector<double> ShortcutGraph::distance_matrix(
+    const std::vector<uint32_t>& source_edges,
+    const std::vector<uint32_t>& target_edges,
+    unsigned threads
+) const {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+    size_t n = edge_ids_.size();
+    size_t rows = source_edges.size(), cols = target_edges.size();
+    if (threads == 0) threads = parallel::default_threads();
+    
+    // Backward phase: settled (edge, distance) pairs of each target
+    std::vector<std::vector<std::pair<uint32_t, double>>> settled(cols);
+    for_each_with_context(cols, threads, [&](size_t j, QueryContext& ctx) {
+        uint32_t target = index_of(target_edges[j]);
+        if (target == NO_INDEX) return;
+        ctx.prepare(n);
+        ctx.bwd.set_dist(target, meta_.cost[target]);
+        ctx.bwd.heap.push_or_decrease(target, meta_.cost[target]);
+        settle_all(ctx.bwd, bwd_, BWD_DOWN, BWD_LATERAL, INF, [&](uint32_t u, double d) {
+            settled[j].push_back({u, d});
+        });
+    });
+    
+    // Buckets by edge, column-sorted, as structure-of-arrays
+    min_plus::Buckets buckets = min_plus::build_buckets(n, settled);
+    min_plus::Kernel kernel = min_plus::best_kernel();
+    
+    // Forward phase: each source owns one row
+    std::vector<double> matrix(rows * cols, INF);
+    for_each_with_context(rows, threads, [&](size_t i, QueryContext& ctx) {
+        uint32_t source = index_of(source_edges[i]);
+        if (source == NO_INDEX) return;
+        std::vector<std::pair<uint32_t, double>> reached;
+        ctx.prepare(n);
+        ctx.fwd.set_dist(source, 0.0);
+        ctx.fwd.heap.push_or_decrease(source, 0.0);
+        settle_all(ctx.fwd, fwd_, 0, 0, INF, [&](uint32_t u, double d) {
+            if (buckets.offsets[u] != buckets.offsets[u + 1]) reached.push_back({u, d});
+        });
+        min_plus::join_row(buckets, reached, matrix.data() + i * cols, cols, kernel);
+    });
+    
+    for (double& d : matrix) {
+        if (d == INF) d = -1;
+    }
+    return matrix;
+}
+
+std::vector<double> ShortcutGraph::one_to_all(uint32_t source_edge, double cutoff) const {
+    return one_to_all({source_edge}, {0.0}, cutoff, thread_context());
+}
+
+std::vector<double> ShortcutGraph::one_to_all(
+    const std::vector<uint32_t>& source_edges,
+    const std::vector<double>& source_dists,
+    double cutoff
+) const {
+    return one_to_all(source_edges, source_dists, cutoff, thread_context());
+}
+
+// One upward search from all sources, then a single-lane sweep;
+// emit(v, distance) for every edge within cutoff
+template <typename Emit>
+void ShortcutGraph::sweep_from(const std::vector<uint32_t>& source_edges, const std::vector<double>& source_dists,
+                               double cutoff, QueryContext& ctx, Emit&& emit) const {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+    size_t n = edge_ids_.size();
+    
+    // Upward phase, labels moved to sweep positions as they settle
+    std::vector<double>& dist = ctx.lanes;
+    dist.assign(n, INF);
+    ctx.prepare(n);
+    for (size_t i = 0; i < source_edges.size(); ++i) {
+        uint32_t source = index_of(source_edges[i]);
+        if (source == NO_INDEX || source_dists[i] >= ctx.fwd.dist(source)) continue;
+        ctx.fwd.set_dist(source, source_dists[i]);
+        ctx.fwd.heap.push_or_decrease(source, source_dists[i]);
+    }
+    settle_all(ctx.fwd, fwd_, 0, 0, cutoff, [&](uint32_t u, double d) {
+        dist[sweep_position_[u]] = d;
+    });
+    
+    sweep_lanes<1>(sweep_, sweep_cyclic_, dist.data());
+    
+    // The backward search starts at the target's own cost; add it here
+    for (uint32_t p = 0; p < n; ++p) {
+        uint32_t v = sweep_order_[p];
+        double d = dist[p] + meta_.cost[v];
+        if (dist[p] < INF && d <= cutoff) emit(v, d);
+    }
+}
+
+std::vector<double> ShortcutGraph::one_to_all(
+    const std::vector<uint32_t>& source_edges,
+    const std::vector<double>& source_dists,
+    double cutoff,
+    QueryContext& ctx
+) const {
+    std::vector<double> out(edge_ids_.size(), -1);
+    sweep_from(source_edges, source_dists, cutoff, ctx, [&](uint32_t v, double d) { out[v] = d; });
+    return out;
+}
+
+// Upward searches of up to K sources, one per lane, then one K-lane sweep;
+// emit(lane, v, distance) for every edge within cutoff of the lane's source
+template <unsigned K, typename Emit>
+void ShortcutGraph::sweep_batch(const uint32_t* source_edges, size_t count, double cutoff, QueryContext& ctx,
+                                Emit&& emit) const {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+    size_t n = edge_ids_.size();
+    std::vector<double>& labels = ctx.lanes;
+    labels.assign(n * K, INF);
+    
+    for (size_t k = 0; k < count; ++k) {
+        uint32_t source = index_of(source_edges[k]);
+        if (source == NO_INDEX) continue;
+        ctx.prepare(n);
+        ctx.fwd.set_dist(source, 0.0);
+        ctx.fwd.heap.push_or_decrease(source, 0.0);
+        settle_all(ctx.fwd, fwd_, 0, 0, cutoff, [&](uint32_t u, double d) {
+            labels[size_t(sweep_position_[u]) * K + k] = d;
+        });
+    }
+    
+    sweep_lanes<K>(sweep_, sweep_cyclic_, labels.data());
+    
+    for (uint32_t p = 0; p < n; ++p) {
+        uint32_t v = sweep_order_[p];
+        const double* label = labels.data() + size_t(p) * K;
+        for (size_t k = 0; k < count; ++k) {
+            double d = label[k] + meta_.cost[v];
+            if (label[k] < INF && d <= cutoff) emit(k, v, d);
         }
     }
+}
+
+template <unsigned K>
+std::vector<double> ShortcutGraph::one_to_all_many(
+    const std::vector<uint32_t>& source_edges,
+    double cutoff,
+    unsigned threads
+) const {
+    size_t n = edge_ids_.size();
+    size_t count = source_edges.size();
+    if (threads == 0) threads = parallel::default_threads();
     
-    if (!found) return {-1, {}, false};
+    std::vector<double> out(count * n, -1);
+    for_each_with_context((count + K - 1) / K, threads, [&](size_t batch, QueryContext& ctx) {
+        size_t first = batch * K;
+        double* rows = out.data() + first * n;
+        sweep_batch<K>(source_edges.data() + first, std::min<size_t>(K, count - first), cutoff, ctx,
+                       [&](size_t lane, uint32_t v, double d) { rows[lane * n + v] = d; });
+    });
+    return out;
+}
+
+template std::vector<double> ShortcutGraph::one_to_all_many<4>(const std::vector<uint32_t>&, double, unsigned) const;
+template std::vector<double> ShortcutGraph::one_to_all_many<8>(const std::vector<uint32_t>&, double, unsigned) const;
+template std::vector<double> ShortcutGraph::one_to_all_many<16>(const std::vector<uint32_t>&, double, unsigned) const;
+
+CellGrouping ShortcutGraph::cell_grouping(int res) const {
+    size_t n = edge_ids_.size();
+    CellGrouping g;
+    g.res = res;
+    g.slot.assign(n, CellGrouping::NO_CELL);
     
-    // Reconstruct path
-    std::vector<uint32_t> path;
-    uint32_t curr = meeting;
-    while (parent_fwd[curr] != curr) {
-        path.push_back(curr);
-        curr = parent_fwd[curr];
+    std::vector<uint64_t> parent(n, 0);
+    for (size_t v = 0; v < n; ++v) {
+        if (meta_.present[v]) parent[v] = h3_utils::cell_to_parent(meta_.incoming_cell[v], res);
     }
-    path.push_back(curr);
-    std::reverse(path.begin(), path.end());
+    g.cells = parent;
+    std::sort(g.cells.begin(), g.cells.end());
+    g.cells.erase(std::unique(g.cells.begin(), g.cells.end()), g.cells.end());
+    if (!g.cells.empty() && g.cells.front() == 0) g.cells.erase(g.cells.begin());
     
-    curr = meeting;
-    while (parent_bwd[curr] != curr) {
-        curr = parent_bwd[curr];
-        path.push_back(curr);
+    for (size_t v = 0; v < n; ++v) {
+        if (parent[v] == 0) continue;
+        g.slot[v] = static_cast<uint32_t>(std::lower_bound(g.cells.begin(), g.cells.end(), parent[v]) - g.cells.begin());
+    }
+    return g;
+}
+
+// Per-cell accumulator of the aggregated one-to-all queries
+namespace {
+struct CellTable {
+    const CellGrouping& cells;
+    CellReduce reduce;
+    
+    double initial() const {
+        return reduce == CellReduce::MIN_DISTANCE ? std::numeric_limits<double>::infinity() : 0.0;
+    }
+    void fold(double* values, uint32_t v, double d) const {
+        uint32_t c = cells.slot[v];
+        if (c == CellGrouping::NO_CELL) return;
+        if (reduce == CellReduce::MIN_DISTANCE) {
+            values[c] = std::min(values[c], d);
+        } else {
+            values[c] += 1;
+        }
+    }
+    void finish(std::vector<double>& values) const {
+        if (reduce != CellReduce::MIN_DISTANCE) return;
+        for (double& x : values) {
+            if (x == std::numeric_limits<double>::infinity()) x = -1;
+        }
+    }
+};
+}  // namespace
+
+std::vector<double> ShortcutGraph::one_to_all_cells(
+    const std::vector<uint32_t>& source_edges,
+    const std::vector<double>& source_dists,
+    const CellGrouping& cells,
+    CellReduce reduce,
+    double cutoff
+) const {
+    CellTable table{cells, reduce};
+    std::vector<double> values(cells.cells.size(), table.initial());
+    if (cells.slot.size() == edge_ids_.size()) {
+        sweep_from(source_edges, source_dists, cutoff, thread_context(),
+                   [&](uint32_t v, double d) { table.fold(values.data(), v, d); });
     }
+    table.finish(values);
+    return values;
+}
+
+template <unsigned K>
+std::vector<double> ShortcutGraph::one_to_all_cells_many(
+    const std::vector<uint32_t>& source_edges,
+    const CellGrouping& cells,
+    CellReduce reduce,
+    double cutoff,
+    unsigned threads
+) const {
+    size_t width = cells.cells.size();
+    size_t count = source_edges.size();
+    if (threads == 0) threads = parallel::default_threads();
     
-    return {best, path, true};
+    CellTable table{cells, reduce};
+    std::vector<double> out(count * width, table.initial());
+    if (cells.slot.size() == edge_ids_.size()) {
+        for_each_with_context((count + K - 1) / K, threads, [&](size_t batch, QueryContext& ctx) {
+            size_t first = batch * K;
+            double* rows = out.data() + first * width;
+            sweep_batch<K>(source_edges.data() + first, std::min<size_t>(K, count - first), cutoff, ctx,
+                           [&](size_t lane, uint32_t v, double d) { table.fold(rows + lane * width, v, d); });
+        });
+    }
+    table.finish(out);
+    return out;
 }
+
+template std::vector<double> ShortcutGraph::one_to_all_cells_many<4>(
+    const std::vector<uint32_t>&, const CellGrouping&, CellReduce, double, unsigned) const;
+template std::vector<double> ShortcutGraph::one_to_all_cells_many<8>(
+    const std::vector<uint32_t>&, const CellGrouping&, CellReduce, double, unsigned) const;
+template std::vector<double> ShortcutGraph::one_to_all_cells_many<16>(
+    const std::vector<uint32_t>&, const CellGrouping&, CellReduce, double, unsigned) const;
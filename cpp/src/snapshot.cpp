@@ -0,0 +1,153 @@
+/**
+ * @file snapshot.cpp
+ * @brief Snapshot writer and mmap reader.
+ */
+
+#include "snapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace snapshot {
+
+uint64_t checksum(const void* data, size_t bytes) {
+    constexpr uint64_t PRIME = 0x100000001b3ULL;
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    size_t words = bytes / 8;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t w;
+        std::memcpy(&w, p + i * 8, 8);
+        h = (h ^ w) * PRIME;
+    }
+    for (size_t i = words * 8; i < bytes; ++i) {
+        h = (h ^ p[i]) * PRIME;
+    }
+    return h;
+}
+
+static uint64_t align_up(uint64_t v) {
+    return (v + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+bool Writer::write(const std::string& path) const {
+    std::vector<SectionEntry> table;
+    uint64_t offset = align_up(sizeof(Header) + sections_.size() * sizeof(SectionEntry));
+    for (const Pending& s : sections_) {
+        SectionEntry e = s.entry;
+        e.offset = offset;
+        e.checksum = checksum(s.data, e.count * e.elem_size);
+        table.push_back(e);
+        offset = align_up(offset + e.count * e.elem_size);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.endian = ENDIAN_MARK;
+    header.file_size = offset;
+    header.section_count = static_cast<uint32_t>(table.size());
+    header.table_checksum = checksum(table.data(), table.size() * sizeof(SectionEntry));
+
+    // Write to a temporary name and rename, so readers never map a partial file
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    static const char zeros[ALIGNMENT] = {};
+    uint64_t pos = 0;
+    auto pad_to = [&](uint64_t target) {
+        out.write(zeros, static_cast<std::streamsize>(target - pos));
+        pos = target;
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(SectionEntry));
+    pos = sizeof(header) + table.size() * sizeof(SectionEntry);
+
+    for (size_t i = 0; i < sections_.size(); ++i) {
+        pad_to(table[i].offset);
+        uint64_t bytes = table[i].count * table[i].elem_size;
+        out.write(static_cast<const char*>(sections_[i].data), static_cast<std::streamsize>(bytes));
+        pos += bytes;
+    }
+    pad_to(offset);
+
+    out.close();
+    if (!out) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+std::shared_ptr<const Mapping> Mapping::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) return nullptr;
+
+    std::shared_ptr<Mapping> m(new Mapping());
+    m->base_ = static_cast<const uint8_t*>(addr);
+    m->size_ = size;
+
+    const Header* h = reinterpret_cast<const Header*>(m->base_);
+    if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != VERSION ||
+        h->endian != ENDIAN_MARK || h->file_size != size) {
+        return nullptr;
+    }
+
+    uint64_t table_bytes = uint64_t(h->section_count) * sizeof(SectionEntry);
+    if (sizeof(Header) + table_bytes > size) return nullptr;
+
+    m->table_ = reinterpret_cast<const SectionEntry*>(m->base_ + sizeof(Header));
+    m->section_count_ = h->section_count;
+    if (checksum(m->table_, table_bytes) != h->table_checksum) return nullptr;
+
+    for (uint32_t i = 0; i < m->section_count_; ++i) {
+        const SectionEntry& s = m->table_[i];
+        if (s.offset % ALIGNMENT != 0 || s.offset > size ||
+            (s.elem_size != 0 && s.count > (size - s.offset) / s.elem_size)) {
+            return nullptr;
+        }
+    }
+
+    return m;
+}
+
+Mapping::~Mapping() {
+    if (base_) ::munmap(const_cast<uint8_t*>(base_), size_);
+}
+
+const SectionEntry* Mapping::find(uint32_t id) const {
+    for (uint32_t i = 0; i < section_count_; ++i) {
+        if (table_[i].id == id) return &table_[i];
+    }
+    return nullptr;
+}
+
+bool Mapping::verify() const {
+    for (uint32_t i = 0; i < section_count_; ++i) {
+        const SectionEntry& s = table_[i];
+        if (checksum(base_ + s.offset, s.count * s.elem_size) != s.checksum) return false;
+    }
+    return true;
+}
+
+}  // namespace snapshot